@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/elit21_bench_codec.dir/bench/bench_codec.cpp.o"
+  "CMakeFiles/elit21_bench_codec.dir/bench/bench_codec.cpp.o.d"
+  "elit21_bench_codec"
+  "elit21_bench_codec.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/elit21_bench_codec.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
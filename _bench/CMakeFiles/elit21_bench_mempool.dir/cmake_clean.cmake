@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/elit21_bench_mempool.dir/bench/bench_mempool.cpp.o"
+  "CMakeFiles/elit21_bench_mempool.dir/bench/bench_mempool.cpp.o.d"
+  "elit21_bench_mempool"
+  "elit21_bench_mempool.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/elit21_bench_mempool.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
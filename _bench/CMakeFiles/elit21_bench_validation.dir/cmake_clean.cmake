@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/elit21_bench_validation.dir/bench/bench_validation.cpp.o"
+  "CMakeFiles/elit21_bench_validation.dir/bench/bench_validation.cpp.o.d"
+  "elit21_bench_validation"
+  "elit21_bench_validation.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/elit21_bench_validation.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
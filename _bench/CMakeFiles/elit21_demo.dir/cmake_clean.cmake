@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/elit21_demo.dir/src/main.cpp.o"
+  "CMakeFiles/elit21_demo.dir/src/main.cpp.o.d"
+  "elit21_demo"
+  "elit21_demo.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/elit21_demo.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
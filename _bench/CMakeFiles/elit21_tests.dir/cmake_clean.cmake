@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/elit21_tests.dir/tests/test_elit21.cpp.o"
+  "CMakeFiles/elit21_tests.dir/tests/test_elit21.cpp.o.d"
+  "elit21_tests"
+  "elit21_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/elit21_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,37 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/block.cpp" "CMakeFiles/elit21core.dir/src/block.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/block.cpp.o.d"
+  "/root/repo/src/block_store.cpp" "CMakeFiles/elit21core.dir/src/block_store.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/block_store.cpp.o.d"
+  "/root/repo/src/blockchain.cpp" "CMakeFiles/elit21core.dir/src/blockchain.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/blockchain.cpp.o.d"
+  "/root/repo/src/codec.cpp" "CMakeFiles/elit21core.dir/src/codec.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/codec.cpp.o.d"
+  "/root/repo/src/concurrent_mempool.cpp" "CMakeFiles/elit21core.dir/src/concurrent_mempool.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/concurrent_mempool.cpp.o.d"
+  "/root/repo/src/dictionary.cpp" "CMakeFiles/elit21core.dir/src/dictionary.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/dictionary.cpp.o.d"
+  "/root/repo/src/hash256.cpp" "CMakeFiles/elit21core.dir/src/hash256.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/hash256.cpp.o.d"
+  "/root/repo/src/header_index.cpp" "CMakeFiles/elit21core.dir/src/header_index.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/header_index.cpp.o.d"
+  "/root/repo/src/lz_codec.cpp" "CMakeFiles/elit21core.dir/src/lz_codec.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/lz_codec.cpp.o.d"
+  "/root/repo/src/mempool.cpp" "CMakeFiles/elit21core.dir/src/mempool.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/mempool.cpp.o.d"
+  "/root/repo/src/node.cpp" "CMakeFiles/elit21core.dir/src/node.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/node.cpp.o.d"
+  "/root/repo/src/payload.cpp" "CMakeFiles/elit21core.dir/src/payload.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/payload.cpp.o.d"
+  "/root/repo/src/readiness.cpp" "CMakeFiles/elit21core.dir/src/readiness.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/readiness.cpp.o.d"
+  "/root/repo/src/rle_codec.cpp" "CMakeFiles/elit21core.dir/src/rle_codec.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/rle_codec.cpp.o.d"
+  "/root/repo/src/seen_filter.cpp" "CMakeFiles/elit21core.dir/src/seen_filter.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/seen_filter.cpp.o.d"
+  "/root/repo/src/sha256.cpp" "CMakeFiles/elit21core.dir/src/sha256.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/sha256.cpp.o.d"
+  "/root/repo/src/thread_pool.cpp" "CMakeFiles/elit21core.dir/src/thread_pool.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/thread_pool.cpp.o.d"
+  "/root/repo/src/transaction.cpp" "CMakeFiles/elit21core.dir/src/transaction.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/transaction.cpp.o.d"
+  "/root/repo/src/wallet.cpp" "CMakeFiles/elit21core.dir/src/wallet.cpp.o" "gcc" "CMakeFiles/elit21core.dir/src/wallet.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
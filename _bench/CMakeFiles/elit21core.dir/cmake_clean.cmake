@@ -0,0 +1,47 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/elit21core.dir/src/block.cpp.o"
+  "CMakeFiles/elit21core.dir/src/block.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/block_store.cpp.o"
+  "CMakeFiles/elit21core.dir/src/block_store.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/blockchain.cpp.o"
+  "CMakeFiles/elit21core.dir/src/blockchain.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/codec.cpp.o"
+  "CMakeFiles/elit21core.dir/src/codec.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/concurrent_mempool.cpp.o"
+  "CMakeFiles/elit21core.dir/src/concurrent_mempool.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/dictionary.cpp.o"
+  "CMakeFiles/elit21core.dir/src/dictionary.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/hash256.cpp.o"
+  "CMakeFiles/elit21core.dir/src/hash256.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/header_index.cpp.o"
+  "CMakeFiles/elit21core.dir/src/header_index.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/lz_codec.cpp.o"
+  "CMakeFiles/elit21core.dir/src/lz_codec.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/mempool.cpp.o"
+  "CMakeFiles/elit21core.dir/src/mempool.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/node.cpp.o"
+  "CMakeFiles/elit21core.dir/src/node.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/payload.cpp.o"
+  "CMakeFiles/elit21core.dir/src/payload.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/readiness.cpp.o"
+  "CMakeFiles/elit21core.dir/src/readiness.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/rle_codec.cpp.o"
+  "CMakeFiles/elit21core.dir/src/rle_codec.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/seen_filter.cpp.o"
+  "CMakeFiles/elit21core.dir/src/seen_filter.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/sha256.cpp.o"
+  "CMakeFiles/elit21core.dir/src/sha256.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/thread_pool.cpp.o"
+  "CMakeFiles/elit21core.dir/src/thread_pool.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/transaction.cpp.o"
+  "CMakeFiles/elit21core.dir/src/transaction.cpp.o.d"
+  "CMakeFiles/elit21core.dir/src/wallet.cpp.o"
+  "CMakeFiles/elit21core.dir/src/wallet.cpp.o.d"
+  "libelit21core.a"
+  "libelit21core.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/elit21core.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,115 @@
+#include "elit21/codec.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Byte-at-a-time RLE loop the codec used before the vectorized engine, kept as the comparison baseline.
+std::string reference_rle_compress(const std::string& raw_block) {
+    std::string out;
+    if (raw_block.empty()) {
+        return out;
+    }
+    out.reserve(raw_block.size());
+    char current = raw_block.front();
+    std::uint8_t run = 1;
+    for (std::size_t i = 1; i < raw_block.size(); ++i) {
+        if (raw_block[i] == current && run < 255) {
+            ++run;
+        } else {
+            out.push_back(static_cast<char>(run));
+            out.push_back(current);
+            current = raw_block[i];
+            run = 1;
+        }
+    }
+    out.push_back(static_cast<char>(run));
+    out.push_back(current);
+    return out;
+}
+
+std::string reference_rle_decompress(const std::string& bytes, std::size_t max_output_bytes) {
+    std::string raw;
+    for (std::size_t i = 0; i < bytes.size(); i += 2) {
+        const auto count = static_cast<unsigned char>(bytes[i]);
+        if (raw.size() + count > max_output_bytes) {
+            throw std::runtime_error("decompressed payload exceeds configured limit");
+        }
+        raw.append(count, bytes[i + 1]);
+    }
+    return raw;
+}
+
+std::string transaction_heavy_block(std::size_t target_bytes) {
+    std::string raw;
+    for (std::uint64_t n = 0; raw.size() < target_bytes; ++n) {
+        raw += "5|alice|3|bob|" + std::to_string(100 + n) + "|" + std::to_string(n % 7) + "|" + std::to_string(n) +
+               "|12|memo-" + std::to_string(n % 1000) + "\n";
+    }
+    return raw;
+}
+
+std::string run_heavy_block(std::size_t target_bytes) {
+    std::string raw;
+    for (std::size_t n = 0; raw.size() < target_bytes; ++n) {
+        raw.append(64 + n % 700, static_cast<char>('A' + n % 26));
+        raw += '|';
+    }
+    return raw;
+}
+
+template <typename Fn>
+double megabytes_per_second(std::size_t bytes_per_call, Fn&& fn) {
+    constexpr int kIterations = 200;
+    std::size_t sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        sink += fn();
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (sink == 0) {
+        std::cerr << "unexpected empty output\n";
+    }
+    return static_cast<double>(bytes_per_call) * kIterations / elapsed / (1024.0 * 1024.0);
+}
+
+void report(const char* label, const std::string& raw) {
+    const auto compressed = elit21::compress_block(raw, "RLE");
+    if (compressed.bytes != reference_rle_compress(raw)) {
+        throw std::runtime_error("RLE output diverges from the reference loop");
+    }
+
+    const auto ref_encode = megabytes_per_second(raw.size(), [&] { return reference_rle_compress(raw).size(); });
+    const auto new_encode = megabytes_per_second(raw.size(), [&] { return elit21::compress_block(raw, "RLE").bytes.size(); });
+    const auto ref_decode = megabytes_per_second(raw.size(), [&] {
+        return reference_rle_decompress(compressed.bytes, raw.size()).size();
+    });
+    const auto new_decode = megabytes_per_second(raw.size(), [&] {
+        return elit21::decompress_block(compressed, raw.size()).size();
+    });
+
+    std::cout << label << " (" << raw.size() << " bytes, ratio " << static_cast<double>(compressed.bytes.size()) / static_cast<double>(raw.size())
+              << ")\n"
+              << "  encode MB/s: reference=" << ref_encode << " engine=" << new_encode << '\n'
+              << "  decode MB/s: reference=" << ref_decode << " engine=" << new_decode << '\n';
+
+    const auto lz = elit21::compress_block(raw, "LZ");
+    const auto lz_encode = megabytes_per_second(raw.size(), [&] { return elit21::compress_block(raw, "LZ").bytes.size(); });
+    const auto lz_decode = megabytes_per_second(raw.size(), [&] { return elit21::decompress_block(lz, raw.size()).size(); });
+    std::cout << "  LZ ratio " << static_cast<double>(lz.bytes.size()) / static_cast<double>(raw.size())
+              << ", encode MB/s=" << lz_encode << ", decode MB/s=" << lz_decode << '\n';
+}
+
+}  // namespace
+
+int main() {
+    std::cout << "RLE backend: " << elit21::rle_backend() << '\n';
+    report("transaction-heavy", transaction_heavy_block(1024 * 1024));
+    report("run-heavy", run_heavy_block(1024 * 1024));
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "elit21/concurrent_mempool.hpp"
+#include "elit21/payload.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Add throughput of ConcurrentMempool with 1, 2, 4 and 8 submitting threads, each its own sender, then the
+// time Mempool takes to build a 1 MiB block template from a full pool, with and without its payload.
+// Usage: elit21_bench_mempool [transactions] [shards]
+int main(int argc, char** argv) {
+    const std::size_t transactions = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 400'000;
+    const std::size_t shards = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 16;
+
+    for (const std::size_t threads : {1, 2, 4, 8}) {
+        const auto per_thread = transactions / threads;
+        std::vector<std::vector<elit21::Transaction>> work(threads);
+        for (std::size_t t = 0; t < threads; ++t) {
+            const auto sender = "sender" + std::to_string(t);
+            work[t].reserve(per_thread);
+            for (std::uint64_t nonce = 0; nonce < per_thread; ++nonce) {
+                work[t].push_back(elit21::Transaction{sender, "bob", 1, 1 + nonce % 97, nonce, ""});
+            }
+        }
+
+        // Headroom so uneven shards never evict: this measures adds, not eviction.
+        elit21::ConcurrentMempool mempool(2 * transactions, shards);
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> submitters;
+        for (std::size_t t = 0; t < threads; ++t) {
+            submitters.emplace_back([&mempool, &work, t] {
+                for (const auto& tx : work[t]) {
+                    mempool.add(tx);
+                }
+            });
+        }
+        for (auto& submitter : submitters) {
+            submitter.join();
+        }
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "threads=" << threads << " added=" << mempool.size()
+                  << " tx/s=" << static_cast<double>(mempool.size()) / seconds << '\n';
+    }
+
+    elit21::Mempool pool;
+    std::map<std::string, std::uint64_t> balances;
+    for (std::uint64_t n = 0; n < 10'000; ++n) {
+        const auto sender = "sender" + std::to_string(n % 1'000);
+        balances[sender] = 1'000'000;
+        pool.add(elit21::Transaction{sender, "bob", 1, 1 + n % 97, n / 1'000, std::string(n % 200, 'm')});
+    }
+    constexpr int kRounds = 100;
+    std::size_t taken = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < kRounds; ++round) {
+        taken += pool.block_template(2'000, 1024 * 1024, balances).size();
+    }
+    auto microseconds =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / kRounds;
+    std::cout << "block_template: pool=" << pool.size() << " taken=" << taken / kRounds << " us=" << microseconds
+              << '\n';
+
+    // What forge_block_from_mempool does: template into a reused vector, payload into a reused builder.
+    std::vector<const elit21::Transaction*> chosen;
+    elit21::PayloadBuilder builder;
+    std::size_t bytes = 0;
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < kRounds; ++round) {
+        pool.block_template(2'000, 1024 * 1024, balances, chosen);
+        bytes += builder.build(chosen).size();
+    }
+    microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / kRounds;
+    std::cout << "template + payload (reused buffers): bytes=" << bytes / kRounds << " us=" << microseconds << '\n';
+}
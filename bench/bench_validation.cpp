@@ -0,0 +1,65 @@
+#include "elit21/blockchain.hpp"
+#include "elit21/sha256.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Ingestion (accept_from_network loop vs accept_batch) and full validation of a synthetic chain, serial and on
+// the work-stealing pool.
+// Usage: elit21_bench_validation [blocks] [threads]
+int main(int argc, char** argv) {
+    const std::size_t blocks = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200'000;
+    const std::size_t threads =
+        argc > 2 ? std::strtoull(argv[2], nullptr, 10) : std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+
+    elit21::Blockchain chain("RAW");
+    std::vector<elit21::CompressedBlock> batch;
+    batch.reserve(blocks);
+    for (std::size_t n = 1; n < blocks; ++n) {
+        batch.push_back(chain.compress_for_transport(chain.create_block("tx:" + std::to_string(n))));
+        chain.accept_from_network(batch.back());
+    }
+
+    const auto ingest = [&](const char* label, std::size_t pool_threads, bool batched) {
+        elit21::Blockchain fresh("RAW");
+        fresh.set_validation_threads(pool_threads);
+        const auto start = std::chrono::steady_clock::now();
+        if (batched) {
+            fresh.accept_batch(batch);
+        } else {
+            for (const auto& compressed : batch) {
+                fresh.accept_from_network(compressed);
+            }
+        }
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << label << ": blocks=" << batch.size()
+                  << " blocks/s=" << static_cast<double>(batch.size()) / seconds << '\n';
+    };
+
+    const auto run = [&](const char* label) {
+        const auto report = chain.validate_with_metrics(elit21::ValidationMode::Full);
+        const auto seconds = static_cast<double>(report.elapsed_microseconds) / 1e6;
+        std::cout << label << ": valid=" << report.valid << " blocks=" << report.blocks_checked
+                  << " blocks/s=" << static_cast<double>(report.blocks_checked) / seconds << '\n';
+        for (std::size_t i = 0; i < report.thread_microseconds.size(); ++i) {
+            std::cout << "  thread " << i << " busy us=" << report.thread_microseconds[i] << '\n';
+        }
+    };
+
+    std::cout << "SHA-256 backends: " << elit21::sha256_backend() << " / batch " << elit21::sha256_batch_backend()
+              << '\n';
+    ingest("accept_from_network", 1, false);
+    ingest("accept_batch", 1, true);
+    ingest(("accept_batch x" + std::to_string(threads)).c_str(), threads, true);
+    run("serial");
+    chain.set_validation_threads(threads);
+    run(("parallel x" + std::to_string(threads)).c_str());
+    return 0;
+}
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "elit21/hash256.hpp"
+
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace elit21 {
@@ -9,18 +13,66 @@ namespace elit21 {
 struct BlockHeader {
     std::uint32_t index{};
     std::uint64_t timestamp{};
-    std::string previous_hash;
+    Hash256 previous_hash;
 };
 
+// Binary records open with this magic and a format version byte; the legacy text format always opens
+// with a decimal digit, which is how deserialize tells them apart.
+inline constexpr std::string_view kBlockMagic = "E21B";
+inline constexpr std::uint8_t kBlockFormatVersion = 2;
+
 struct Block {
     BlockHeader header;
     std::string payload;
-    std::string hash;
+    Hash256 hash;
 
+    // Binary wire format: magic, version, u32 index, u64 timestamp (little-endian), the 32-byte previous_hash,
+    // the payload as a varint-length byte string, then the 32-byte hash. Version 1 records, which stored both
+    // hashes as varint-length strings, are still read.
     [[nodiscard]] std::string serialize() const;
-    static Block deserialize(const std::string& raw);
+    [[nodiscard]] std::string serialize_text() const;
+    // Accepts both the binary and the legacy text format.
+    static Block deserialize(std::string_view raw);
+};
+
+// Parses a serialized block (either format) in place. The payload borrows from `raw`, which must outlive the
+// view; the hashes are copied out.
+class BlockView {
+  public:
+    [[nodiscard]] static BlockView parse(std::string_view raw);
+
+    [[nodiscard]] std::uint32_t index() const { return index_; }
+    [[nodiscard]] std::uint64_t timestamp() const { return timestamp_; }
+    [[nodiscard]] const Hash256& previous_hash() const { return previous_hash_; }
+    [[nodiscard]] std::string_view payload() const { return payload_; }
+    [[nodiscard]] const Hash256& hash() const { return hash_; }
+
+    [[nodiscard]] Block to_block() const;
+
+  private:
+    [[nodiscard]] static BlockView parse_binary(std::string_view raw);
+    [[nodiscard]] static BlockView parse_text(std::string_view raw);
+
+    std::uint32_t index_{};
+    std::uint64_t timestamp_{};
+    Hash256 previous_hash_;
+    std::string_view payload_;
+    Hash256 hash_;
 };
 
-[[nodiscard]] std::string compute_hash(const BlockHeader& header, const std::string& payload);
+// SHA-256 over the 76-byte header preimage: u32 index, u64 timestamp, previous_hash, SHA-256(payload).
+[[nodiscard]] Hash256 compute_hash(const BlockHeader& header, const std::string& payload);
+// Same hash from an already computed payload digest, so headers can be checked without their payload.
+[[nodiscard]] Hash256 compute_hash(const BlockHeader& header, const Hash256& payload_digest);
+
+// Bytes a serialized block adds around its payload, at most: magic, version, index, timestamp, both hashes and
+// a payload length varint of up to 10 bytes.
+inline constexpr std::size_t kMaxBlockFramingBytes = kBlockMagic.size() + 1 + 4 + 8 + 2 * Hash256::kSize + 10;
+
+inline constexpr std::size_t kHeaderPreimageBytes = 4 + 8 + 2 * Hash256::kSize;
+void append_header_preimage(std::string& out, const BlockHeader& header, const Hash256& payload_digest);
+// compute_hash for every block, hashing payloads and then headers through sha256_batch.
+[[nodiscard]] std::vector<Hash256> compute_hashes(const std::vector<Block>& blocks);
+[[nodiscard]] std::vector<Hash256> compute_hashes(const Block* blocks, std::size_t count);
 
 }  // namespace elit21
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "elit21/block.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace elit21 {
+
+// Append-only persistent chain: serialized blocks go to numbered segment files (blk00000.dat, ...) and one
+// fixed-size entry per height goes to index.dat. The index entry carries the block's location, timestamp,
+// hash and payload digest, so headers are available without touching the segments. The index is memory-mapped on open, so
+// reopening costs one mmap regardless of chain length. Appended blocks become durable together in sync(): the
+// segments are synced once, then the index entries are written and synced. After a crash only the entries of
+// the last sync can be torn; entries that point past the segments, are empty or do not match their record are
+// truncated away. validated.dat holds the height below which the caller has validated the stored blocks.
+class BlockStore {
+  public:
+    static constexpr std::uint64_t kDefaultSegmentBytes = 64ULL * 1024 * 1024;
+    static constexpr std::size_t kMaxUnsyncedEntries = 1024;
+
+    explicit BlockStore(const std::filesystem::path& directory, std::uint64_t max_segment_bytes = kDefaultSegmentBytes);
+    ~BlockStore();
+
+    BlockStore(const BlockStore&) = delete;
+    BlockStore& operator=(const BlockStore&) = delete;
+
+    [[nodiscard]] std::size_t size() const { return mapped_count_ + appended_.size(); }
+
+    // `block.header.index` must equal size(); `payload_digest` is SHA-256 of the payload. The block is readable
+    // at once but durable only after the next sync(), which runs by itself every kMaxUnsyncedEntries blocks.
+    void append(const Block& block, const Hash256& payload_digest);
+    // Makes every appended block durable. Also run by truncate and on destruction.
+    void sync();
+    // Drops the blocks at `height` and above, lowering the validated height first.
+    void truncate(std::size_t height);
+
+    // Reads the block body back from its segment. Reads may run concurrently with each other, not with append.
+    [[nodiscard]] Block read(std::size_t height) const;
+    [[nodiscard]] std::vector<Block> read_range(std::size_t first, std::size_t last) const;
+    [[nodiscard]] BlockHeader header(std::size_t height) const;
+    [[nodiscard]] Hash256 hash(std::size_t height) const;
+    [[nodiscard]] std::uint64_t timestamp(std::size_t height) const;
+    [[nodiscard]] Hash256 payload_digest(std::size_t height) const;
+
+    // Never above size(). A watermark that lags the blocks only costs a re-check, so raising it is not synced;
+    // lowering it is, before any block it no longer covers can be replaced.
+    [[nodiscard]] std::size_t validated_height() const { return validated_height_; }
+    void set_validated_height(std::size_t height);
+
+  private:
+    struct Entry {
+        std::uint32_t segment;
+        std::uint32_t size;
+        std::uint64_t offset;
+        std::uint64_t timestamp;
+        Hash256 hash;
+        Hash256 payload_digest;
+    };
+
+    [[nodiscard]] Entry entry(std::size_t height) const;
+    void map_index(std::size_t bytes);
+    void recover(std::size_t entries);
+    void open_segment(std::uint32_t segment);
+    void close_all();
+
+    std::filesystem::path directory_;
+    std::uint64_t max_segment_bytes_;
+    int index_fd_{-1};
+    int validated_fd_{-1};
+    std::size_t validated_height_{0};
+    const unsigned char* mapped_{nullptr};
+    std::size_t mapped_bytes_{0};
+    std::size_t mapped_count_{0};
+    std::vector<Entry> appended_;
+    // The last `unsynced_` entries of appended_ are not in index.dat yet; their records start in
+    // `first_unsynced_segment_`.
+    std::size_t unsynced_{0};
+    std::uint32_t first_unsynced_segment_{0};
+    std::vector<int> segment_fds_;
+    std::uint64_t tail_bytes_{0};
+};
+
+}  // namespace elit21
@@ -1,21 +1,118 @@
 #pragma once
 
 #include "elit21/block.hpp"
+#include "elit21/block_store.hpp"
 #include "elit21/codec.hpp"
+#include "elit21/dictionary.hpp"
+#include "elit21/header_index.hpp"
+#include "elit21/thread_pool.hpp"
 
 #include <cstdint>
 #include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace elit21 {
 
+enum class ValidationMode {
+    // Checks only the blocks above the validated-height watermark. Blocks linked through
+    // accept_from_network already passed every check at accept time and move the watermark with them.
+    Incremental,
+    // Re-checks the whole chain from genesis, for audits.
+    Full,
+    // Re-checks the whole header chain from genesis without reading any payload: linkage, timestamps and
+    // each hash recomputed from the payload digest recorded when the block was linked.
+    Headers,
+};
+
 struct ValidationReport {
+    ValidationMode mode{ValidationMode::Full};
     bool valid{false};
+    std::size_t first_block_checked{0};
     std::size_t blocks_checked{0};
     std::uint64_t elapsed_microseconds{0};
     std::size_t failed_block_index{0};
     std::string failure_reason;
+    // Busy time of each validation thread; empty for a serial pass.
+    std::vector<std::uint64_t> thread_microseconds;
+};
+
+// Per-codec transport counters: encodes done by compress_for_transport, decodes done on accept.
+struct CodecStatistics {
+    std::string codec;
+    std::uint64_t encoded_blocks{0};
+    std::uint64_t encode_bytes_in{0};
+    std::uint64_t encode_bytes_out{0};
+    std::uint64_t encode_nanoseconds{0};
+    std::uint64_t decoded_blocks{0};
+    std::uint64_t decode_bytes_in{0};
+    std::uint64_t decode_bytes_out{0};
+    std::uint64_t decode_nanoseconds{0};
+};
+
+// When enabled, the peer-list overloads of compress_for_transport trial-compress a sample of the serialized
+// block with every codec the peer supports and keeps the smallest estimate whose projected encode cost
+// fits the budget. A block that a codec would inflate is sent RAW when the peer accepts it.
+struct AdaptiveCodecPolicy {
+    bool enabled{false};
+    std::size_t sample_bytes{8 * 1024};
+    std::uint64_t max_encode_nanoseconds_per_kib{50'000};
+};
+
+// Blocks that arrive ahead of the tip, with a parent we do not have yet, wait in the orphan pool instead of
+// being rejected. Past either cap the oldest orphans are evicted; orphans older than `expiry_seconds` are
+// dropped. `max_blocks == 0` disables the pool, and early blocks are rejected again.
+struct OrphanPolicy {
+    std::size_t max_blocks{256};
+    std::size_t max_bytes{8 * 1024 * 1024};
+    std::uint64_t expiry_seconds{600};
+};
+
+struct OrphanStatistics {
+    std::size_t blocks{0};
+    std::size_t bytes{0};
+    std::uint64_t added{0};
+    // Orphans linked once their parent arrived.
+    std::uint64_t connected{0};
+    // Orphans whose parent arrived but that then failed linkage.
+    std::uint64_t rejected{0};
+    std::uint64_t expired{0};
+    std::uint64_t evicted{0};
+};
+
+// A block height and hash known in advance to belong to the valid chain, e.g. shipped with the release.
+struct AssumeValidCheckpoint {
+    std::size_t height{0};
+    Hash256 hash;
+};
+
+class Blockchain;
+
+// Read-only, vector-like view of a chain. Blocks below the resident window of a persistent chain are read
+// back from its block store on access, so elements are returned by value.
+class ChainView {
+  public:
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] bool empty() const { return size() == 0; }
+    [[nodiscard]] Block operator[](std::size_t height) const;
+    [[nodiscard]] Block front() const { return (*this)[0]; }
+    [[nodiscard]] Block back() const { return (*this)[size() - 1]; }
+    // Blocks [first, last).
+    [[nodiscard]] std::vector<Block> blocks(std::size_t first, std::size_t last) const;
+
+  private:
+    friend class Blockchain;
+
+    explicit ChainView(const Blockchain& chain) : chain_(&chain) {}
+
+    const Blockchain* chain_;
 };
 
 class Blockchain {
@@ -23,23 +120,190 @@ class Blockchain {
     explicit Blockchain(std::string preferred_codec = "RLE",
                         std::size_t max_transport_block_bytes = 1024 * 1024,
                         std::uint64_t max_future_drift_seconds = 120);
+    ~Blockchain();
+    Blockchain(Blockchain&&) noexcept;
+    Blockchain& operator=(Blockchain&&) noexcept;
 
-    [[nodiscard]] const std::vector<Block>& chain() const { return chain_; }
+    // Opens (or creates) a chain persisted in `directory`. Every linked block is appended to the store, and
+    // only the most recent blocks stay in memory. The validated-height watermark is persisted with the store,
+    // so blocks found there count as validated only up to it: blocks linked under assume-valid and not yet
+    // checked stay above it for ValidationMode::Incremental, and ValidationMode::Full re-checks them all.
+    [[nodiscard]] static Blockchain open(const std::filesystem::path& directory,
+                                         std::string preferred_codec = "RLE",
+                                         std::size_t max_transport_block_bytes = 1024 * 1024,
+                                         std::uint64_t max_future_drift_seconds = 120);
+
+    [[nodiscard]] ChainView chain() const { return ChainView(*this); }
+    [[nodiscard]] std::size_t height() const { return headers_.size(); }
+    [[nodiscard]] const HeaderIndex& headers() const { return headers_; }
+    [[nodiscard]] Block block_at(std::size_t height) const;
+    [[nodiscard]] std::optional<Block> find_block(const Hash256& hash) const;
+    [[nodiscard]] std::vector<Block> blocks(std::size_t first, std::size_t last) const;
+    [[nodiscard]] bool persistent() const { return store_ != nullptr; }
+    // Largest serialized block a peer accepts; forged blocks must stay within it.
+    [[nodiscard]] std::size_t max_transport_block_bytes() const { return max_transport_block_bytes_; }
     [[nodiscard]] Block create_block(const std::string& payload) const;
     [[nodiscard]] CompressedBlock compress_for_transport(const Block& block) const;
+    // `peer_codecs` as advertised by the peer; the names are resolved once, then negotiation runs on ids.
     [[nodiscard]] CompressedBlock compress_for_transport(const Block& block, const std::vector<std::string>& peer_codecs) const;
+    // Same negotiation for codecs already resolved to ids (see codec_ids).
+    [[nodiscard]] CompressedBlock compress_for_codec_ids(const Block& block, const std::vector<CodecId>& peer_codecs) const;
+    // Uses the shared-dictionary codec when the peer offers "LZD" and holds one of our dictionaries
+    // (newest first); otherwise negotiates a plain codec from `peer_codecs`.
+    [[nodiscard]] CompressedBlock compress_for_transport(const Block& block,
+                                                         const std::vector<std::string>& peer_codecs,
+                                                         const std::vector<std::string>& peer_dictionaries) const;
+
+    void set_adaptive_codec_policy(const AdaptiveCodecPolicy& policy);
+    [[nodiscard]] const AdaptiveCodecPolicy& adaptive_codec_policy() const { return adaptive_policy_; }
+    [[nodiscard]] std::vector<CodecStatistics> codec_statistics() const;
+
+    void set_orphan_policy(const OrphanPolicy& policy);
+    [[nodiscard]] const OrphanPolicy& orphan_policy() const { return orphan_policy_; }
+    [[nodiscard]] OrphanStatistics orphan_statistics() const;
+
+    // Trains a dictionary from the serialized form of the most recent blocks and returns its id.
+    std::string train_dictionary(std::size_t recent_blocks = 64, std::size_t max_bytes = 16 * 1024);
+    void add_dictionary(const CompressionDictionary& dictionary);
+    [[nodiscard]] std::vector<std::string> dictionary_ids() const;
+    [[nodiscard]] const CompressionDictionary& dictionary(const std::string& id) const;
 
+    // A block whose parent is unknown and whose index is above the tip is held in the orphan pool; when its
+    // parent is linked, every orphan waiting on the new tip is linked in the same call.
     void accept_from_network(const CompressedBlock& compressed_block);
+    // Bulk form of accept_from_network for initial sync. Blocks are decoded and hashed ahead of the tip, on the
+    // validation pool when one is set, while earlier blocks are linked in order on the calling thread. Blocks
+    // before the first bad one are linked and that block's error is rethrown, exactly as a loop over
+    // accept_from_network would.
+    void accept_batch(const std::vector<CompressedBlock>& compressed_blocks);
+    // Links an already decoded block, e.g. one replayed from local storage, without the transport round trip.
+    void accept_block(Block block);
+
+    // Initial block download. Up to the checkpoint height, blocks are only checked for index and parent
+    // linkage; timestamps and hashes are left to one batched header pass that runs once the checkpoint
+    // block, which must carry the checkpoint hash, is linked. That pass ends the mode. If the history is
+    // invalid, every block linked since the mode began is unlinked and dropped from the store, and the
+    // error is thrown, even when the checkpoint block links from the orphan pool.
+    void begin_initial_download(const AssumeValidCheckpoint& checkpoint);
+    [[nodiscard]] bool in_initial_download() const { return assume_valid_.has_value(); }
+    // Runs the deferred pass over whatever was linked so far and leaves the mode, unlinking all of it when the
+    // pass fails.
+    ValidationReport finish_initial_download();
+
+    // Incremental variant of accept_from_network for bytes still arriving from a peer: the block is decoded
+    // chunk by chunk into an arena owned by the chain and reused across blocks.
+    void begin_network_block(CodecId codec, std::uint8_t version = 1, const std::string& dictionary_id = "");
+    void feed_network_block(std::string_view chunk);
+    void finish_network_block();
     [[nodiscard]] bool is_valid() const;
-    [[nodiscard]] ValidationReport validate_with_metrics() const;
+    [[nodiscard]] ValidationReport validate_with_metrics(ValidationMode mode = ValidationMode::Incremental) const;
+    [[nodiscard]] std::size_t validated_height() const { return validated_height_; }
+    // Spreads validation passes and accept_batch decoding over a work-stealing pool of `threads` workers; 0 or 1
+    // keeps them on one thread.
+    void set_validation_threads(std::size_t threads);
 
   private:
-    [[nodiscard]] std::string negotiate_codec(const std::vector<std::string>& peer_codecs) const;
+    struct SharedDictionary {
+        std::shared_ptr<const CompressionDictionary> dictionary;
+        std::shared_ptr<const BlockCodec> codec;
+    };
+
+    struct CodecTelemetry;
+
+    struct Orphan {
+        Block block;
+        Hash256 payload_digest;
+        std::uint64_t received{0};
+        std::uint64_t sequence{0};
+    };
+
+    // A block decoded and hashed by accept_batch, waiting to be linked.
+    struct PreparedBlock {
+        Block block;
+        Hash256 payload_digest;
+        Hash256 computed_hash;
+        std::exception_ptr error;
+    };
+
+    static constexpr std::size_t kMaxDictionaries = 8;
+    static constexpr std::size_t kValidationChunk = 4096;
+    // A persistent chain keeps between kResidentBlocks and twice that many recent blocks in memory.
+    static constexpr std::size_t kResidentBlocks = 1024;
+    // accept_batch prepares this many blocks while the previous window is being linked.
+    static constexpr std::size_t kIngestWindow = 1024;
+    static constexpr std::size_t kIngestSlice = 64;
+
+    [[nodiscard]] CompressedBlock encode_for_transport(const std::string& raw_block, const BlockCodec& codec) const;
+    [[nodiscard]] const BlockCodec& choose_adaptive_codec(const std::string& raw_block,
+                                                          const std::vector<CodecId>& peer_codecs) const;
+    void record_decode(const BlockCodec& codec, std::uint64_t bytes_in, std::uint64_t bytes_out, std::uint64_t nanoseconds) const;
+
+    [[nodiscard]] const SharedDictionary* find_dictionary(const std::string& id) const;
+    [[nodiscard]] const BlockCodec& negotiate_codec(const std::vector<CodecId>& peer_codecs) const;
+    // Resolves the codec of a network block; `dictionary_codec` keeps a dictionary codec alive.
+    [[nodiscard]] const BlockCodec& network_codec(CodecId codec,
+                                                  std::uint8_t version,
+                                                  const std::string& dictionary_id,
+                                                  std::shared_ptr<const BlockCodec>& dictionary_codec) const;
+    void prepare_blocks(const std::vector<CompressedBlock>& compressed_blocks,
+                        std::size_t first,
+                        std::vector<PreparedBlock>& prepared) const;
+    void accept_block(Block block, const Hash256& payload_digest, const Hash256& computed_hash, std::uint64_t now);
+    void link_block(Block block, const Hash256& payload_digest, const Hash256& computed_hash, std::uint64_t now);
+    // Makes the blocks linked so far durable; every public entry point that links blocks ends with it.
+    void sync_store();
+    [[nodiscard]] bool assumed_valid(std::size_t height) const {
+        return assume_valid_.has_value() && height <= assume_valid_->height;
+    }
+    // Unlinks the blocks at `new_height` and above, from memory and from the store.
+    void truncate(std::size_t new_height);
+    void add_orphan(Block block, const Hash256& payload_digest, std::uint64_t now);
+    void connect_orphans(std::uint64_t now);
+    void expire_orphans(std::uint64_t now);
+    void enforce_orphan_caps();
+    Orphan take_orphan(std::uint64_t sequence);
+    // Moves the watermark, and the store's copy of it.
+    void set_validated_height(std::size_t height) const;
+    [[nodiscard]] ValidationReport validate_from(std::size_t first, ValidationMode mode) const;
+    void check_blocks(std::size_t first, bool with_payloads, ValidationReport& report) const;
+    void check_blocks_parallel(std::size_t first, bool with_payloads, ValidationReport& report) const;
+    // Checks headers [begin, end) and, with `with_payloads`, that each block body still matches its header. On
+    // failure sets `failed_at` and returns the reason.
+    [[nodiscard]] const char* check_range(std::size_t begin,
+                                          std::size_t end,
+                                          std::uint64_t now,
+                                          bool with_payloads,
+                                          std::size_t& failed_at) const;
+    [[nodiscard]] const char* check_link(std::size_t i, const Hash256& computed_hash, std::uint64_t now) const;
 
-    std::vector<Block> chain_;
-    std::string preferred_codec_;
+    HeaderIndex headers_;
+    // Block bodies [resident_base_, height()); older bodies live only in store_.
+    std::vector<Block> resident_;
+    std::size_t resident_base_{0};
+    std::unique_ptr<BlockStore> store_;
+    // Blocks [0, validated_height_) are known to pass validation.
+    mutable std::size_t validated_height_{0};
+    std::optional<AssumeValidCheckpoint> assume_valid_;
+    std::unique_ptr<ThreadPool> validation_pool_;
+    const BlockCodec* preferred_codec_;
     std::size_t max_transport_block_bytes_;
     std::uint64_t max_future_drift_seconds_;
+    std::vector<SharedDictionary> dictionaries_;
+    AdaptiveCodecPolicy adaptive_policy_;
+    std::unique_ptr<CodecTelemetry> telemetry_;
+    OrphanPolicy orphan_policy_;
+    OrphanStatistics orphan_statistics_;
+    // Keyed by previous_hash; orphan_arrivals_ maps arrival sequence to that key, oldest first.
+    std::unordered_multimap<Hash256, Orphan> orphans_;
+    std::map<std::uint64_t, Hash256> orphan_arrivals_;
+    std::uint64_t next_orphan_sequence_{0};
+    StreamDecompressor decompressor_;
+    std::shared_ptr<const BlockCodec> stream_codec_;
+    const BlockCodec* stream_selected_{nullptr};
+    std::uint64_t stream_bytes_in_{0};
+    std::uint64_t stream_nanoseconds_{0};
+    std::string decode_arena_;
+    bool network_block_open_{false};
 };
 
 }  // namespace elit21
@@ -2,20 +2,92 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace elit21 {
 
+// Wire-level codec identifiers. Built-in codecs own the low values; plugged-in codecs pick any free id.
+enum class CodecId : std::uint8_t {
+    Raw = 0,
+    Rle = 1,
+    Lz = 2,
+    LzDictionary = 3,
+};
+
 struct CompressedBlock {
     std::uint8_t version{1};
-    std::string codec{"RLE"};
+    // A name received from a peer is resolved once, with codec_id, when the block comes off the wire.
+    CodecId codec{CodecId::Rle};
     std::string bytes;
+    // Set when `codec` is dictionary-based; names the shared dictionary both peers must hold.
+    std::string dictionary_id;
+};
+
+// Resumable decoding state. The output buffer is owned by the caller; `scratch` is codec-private and lets a
+// codec park a partially received token between chunks without allocating.
+struct DecodeState {
+    char* output{nullptr};
+    std::size_t capacity{0};
+    std::size_t produced{0};
+    std::uint32_t stage{0};
+    std::uint64_t scratch[4]{};
 };
 
+class BlockCodec {
+  public:
+    virtual ~BlockCodec() = default;
+
+    [[nodiscard]] virtual CodecId id() const = 0;
+    [[nodiscard]] virtual std::string_view name() const = 0;
+    virtual void compress(std::string_view raw_block, std::string& out) const = 0;
+    [[nodiscard]] virtual std::string decompress(std::string_view bytes, std::size_t max_output_bytes) const = 0;
+
+    // Streaming decode: consume `chunk` entirely, writing at most state.capacity bytes in total.
+    virtual void decode_chunk(DecodeState& state, std::string_view chunk) const;
+    // Throws when the bytes fed so far do not form a complete stream.
+    virtual void decode_finish(const DecodeState& state) const;
+};
+
+// Decodes a compressed block chunk by chunk into a caller-owned buffer. The decompressor holds no heap
+// memory, so one instance (and one output arena) can be reused for every block of a sync session.
+class StreamDecompressor {
+  public:
+    void reset(const BlockCodec& codec, char* output, std::size_t capacity);
+    void feed(std::string_view chunk);
+    [[nodiscard]] std::size_t finish();
+    [[nodiscard]] std::size_t produced() const { return state_.produced; }
+
+  private:
+    const BlockCodec* codec_{nullptr};
+    DecodeState state_;
+};
+
+[[nodiscard]] const BlockCodec& raw_codec();
+[[nodiscard]] const BlockCodec& rle_codec();
+[[nodiscard]] const BlockCodec& lz_codec();
+
+// Codec lookup is a table index by id; names are only resolved at the API boundary. The registry is not
+// locked: register plugged-in codecs before any thread starts, since accept_batch and the validation pool
+// look codecs up concurrently.
+void register_codec(std::unique_ptr<BlockCodec> codec);
+[[nodiscard]] const BlockCodec* find_codec(CodecId id);
+// Linear in the registered codecs; for names arriving from a peer or a caller, never for dispatch.
+[[nodiscard]] const BlockCodec* find_codec(std::string_view name);
+// Id of a registered codec, or of the shared-dictionary codec (kDictionaryCodecName).
+[[nodiscard]] std::optional<CodecId> codec_id(std::string_view name);
+// A peer's advertised codec names as ids, in the peer's order, dropping names we do not know.
+[[nodiscard]] std::vector<CodecId> codec_ids(const std::vector<std::string>& names);
+
 [[nodiscard]] std::vector<std::string> supported_codecs();
+[[nodiscard]] std::vector<CodecId> supported_codec_ids();
 [[nodiscard]] bool is_supported_codec(const std::string& codec);
+[[nodiscard]] std::string rle_backend();
 [[nodiscard]] CompressedBlock compress_block(const std::string& raw_block, const std::string& codec = "RLE");
+[[nodiscard]] CompressedBlock compress_block(const std::string& raw_block, const BlockCodec& codec);
 [[nodiscard]] std::string decompress_block(const CompressedBlock& compressed, std::size_t max_output_bytes = 1024 * 1024);
 
 }  // namespace elit21
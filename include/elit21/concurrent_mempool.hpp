@@ -0,0 +1,90 @@
+#pragma once
+
+#include "elit21/mempool.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace elit21 {
+
+// Thread-safe mempool for concurrent submission, with the same replace-by-fee and eviction rules as Mempool.
+// Transactions are spread over shards by id, each with its own lock and priority set, so adds and lookups of
+// different transactions rarely contend. Per-sender nonce slots live in a second set of shards keyed by
+// sender, which serializes the adds of one sender and nothing else. Capacity and eviction apply per shard.
+// A standalone building block for callers that submit from several threads: Node keeps its Mempool.
+class ConcurrentMempool {
+  public:
+    explicit ConcurrentMempool(std::size_t max_transactions = 10'000, std::size_t shards = 16);
+
+    ConcurrentMempool(const ConcurrentMempool&) = delete;
+    ConcurrentMempool& operator=(const ConcurrentMempool&) = delete;
+
+    // All members may be called from any number of threads.
+    void add(const Transaction& tx);
+    [[nodiscard]] bool contains(const Hash256& tx_id) const;
+    [[nodiscard]] std::size_t size() const { return size_.load(std::memory_order_relaxed); }
+    void remove_committed(const std::vector<Transaction>& committed);
+    [[nodiscard]] MempoolStatistics statistics() const;
+    // Senders holding at least one nonce slot; never more than size() once concurrent adds have returned.
+    [[nodiscard]] std::size_t tracked_senders() const;
+
+    // Every pending transaction in priority order, as of a single instant: all shards are locked together
+    // for the copy, never while waiting on anything else.
+    [[nodiscard]] std::vector<Transaction> snapshot() const;
+    // Mempool::select_for_block over the same cut as snapshot(), so both pools pick the same block: each
+    // sender's transactions in nonce order up to the first gap and, with `balances`, within the sender's
+    // balance. Writers stall only for the copy; the selection runs after the locks are released. Each call
+    // copies every pending transaction and rebuilds a Mempool from them, O(n log n) in the pool size however
+    // small `limit` is: meant for block production, not for polling.
+    [[nodiscard]] std::vector<Transaction> select_for_block(std::size_t limit) const;
+    [[nodiscard]] std::vector<Transaction> select_for_block(std::size_t limit,
+                                                            const std::map<std::string, std::uint64_t>& balances) const;
+
+  private:
+    struct Entry {
+        Transaction tx;
+        std::uint64_t sequence;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<Hash256, Entry> by_id;
+        std::set<MempoolPriority> by_priority;
+    };
+
+    // Nonce -> id slots of each sender. An add that evicts another sender's transaction clears its slot once
+    // the id shard is released; until then slots are checked against the id shards before use.
+    struct SenderShard {
+        std::mutex mutex;
+        std::unordered_map<std::string, std::map<std::uint64_t, Hash256>> by_sender;
+    };
+
+    [[nodiscard]] Shard& shard_of(const Hash256& tx_id) const;
+    [[nodiscard]] SenderShard& sender_shard_of(const std::string& sender) const;
+    [[nodiscard]] std::vector<std::unique_lock<std::mutex>> lock_all() const;
+    void erase_locked(Shard& shard, const Hash256& tx_id);
+    // Drops the nonce slot of `evicted` unless it was re-added meanwhile; takes the sender's shard lock.
+    void release_slot(const Transaction& evicted);
+    [[nodiscard]] std::vector<Transaction> collect(std::size_t per_shard_limit, std::size_t limit) const;
+    // Every pending transaction, re-added to a Mempool in arrival order.
+    [[nodiscard]] Mempool pending_pool() const;
+
+    std::size_t max_per_shard_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<std::unique_ptr<SenderShard>> sender_shards_;
+    std::atomic<std::size_t> size_{0};
+    std::atomic<std::uint64_t> next_sequence_{0};
+    std::atomic<std::uint64_t> replaced_{0};
+    std::atomic<std::uint64_t> evicted_{0};
+    std::atomic<std::uint64_t> rejected_{0};
+};
+
+}  // namespace elit21
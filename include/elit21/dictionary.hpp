@@ -0,0 +1,39 @@
+#pragma once
+
+#include "elit21/codec.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace elit21 {
+
+inline constexpr std::string_view kDictionaryCodecName = "LZD";
+
+// Shared history for the "LZD" codec. Both peers must hold the same content; the id (a digest of the
+// content) is what travels on the wire and what peers advertise during negotiation.
+class CompressionDictionary {
+  public:
+    static constexpr std::size_t kMinBytes = 8;
+    static constexpr std::size_t kMaxBytes = 65535;
+
+    explicit CompressionDictionary(std::string content);
+
+    [[nodiscard]] const std::string& id() const { return id_; }
+    [[nodiscard]] const std::string& content() const { return content_; }
+
+    // Picks the segments of `samples` whose 8-byte substrings recur most often across the set, most
+    // valuable last so that the matches LZ finds against them get the shortest offsets.
+    [[nodiscard]] static CompressionDictionary train(const std::vector<std::string>& samples, std::size_t max_bytes);
+
+  private:
+    std::string content_;
+    std::string id_;
+};
+
+[[nodiscard]] std::shared_ptr<const BlockCodec> make_dictionary_codec(
+    std::shared_ptr<const CompressionDictionary> dictionary);
+
+}  // namespace elit21
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "elit21/sha256.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace elit21 {
+
+// 32-byte digest held by value: block hashes, transaction ids and signatures. The all-zero value is the null
+// hash, used as the genesis block's parent.
+class Hash256 {
+  public:
+    static constexpr std::size_t kSize = 32;
+
+    Hash256() = default;
+    explicit Hash256(const Digest256& digest) : bytes_(digest) {}
+
+    // Both throw std::runtime_error unless given exactly 32 bytes / 64 hex digits.
+    [[nodiscard]] static Hash256 from_bytes(std::string_view bytes);
+    [[nodiscard]] static Hash256 from_hex(std::string_view hex);
+
+    [[nodiscard]] std::string to_hex() const;
+    [[nodiscard]] const std::uint8_t* data() const { return bytes_.data(); }
+    [[nodiscard]] std::string_view bytes() const {
+        return std::string_view(reinterpret_cast<const char*>(bytes_.data()), kSize);
+    }
+    [[nodiscard]] bool is_zero() const { return *this == Hash256{}; }
+
+    friend bool operator==(const Hash256& a, const Hash256& b) {
+#if defined(__SSE2__)
+        const auto* pa = reinterpret_cast<const __m128i*>(a.bytes_.data());
+        const auto* pb = reinterpret_cast<const __m128i*>(b.bytes_.data());
+        const __m128i low = _mm_cmpeq_epi8(_mm_load_si128(pa), _mm_load_si128(pb));
+        const __m128i high = _mm_cmpeq_epi8(_mm_load_si128(pa + 1), _mm_load_si128(pb + 1));
+        return _mm_movemask_epi8(_mm_and_si128(low, high)) == 0xFFFF;
+#else
+        return std::memcmp(a.bytes_.data(), b.bytes_.data(), kSize) == 0;
+#endif
+    }
+    friend bool operator!=(const Hash256& a, const Hash256& b) { return !(a == b); }
+    friend bool operator<(const Hash256& a, const Hash256& b) {
+        return std::memcmp(a.bytes_.data(), b.bytes_.data(), kSize) < 0;
+    }
+
+  private:
+    alignas(16) Digest256 bytes_{};
+};
+
+}  // namespace elit21
+
+namespace std {
+
+// Digests are uniformly distributed, so any eight of their bytes already make a good bucket hash.
+template <>
+struct hash<elit21::Hash256> {
+    std::size_t operator()(const elit21::Hash256& hash) const noexcept {
+        std::size_t value;
+        std::memcpy(&value, hash.data(), sizeof(value));
+        return value;
+    }
+};
+
+}  // namespace std
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "elit21/block.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace elit21 {
+
+// Headers of every linked block, one column per field, plus an open-addressing hash -> height table. A
+// block's height is its position, which linkage keeps equal to its header index. Each header also carries
+// the SHA-256 of its payload, so block hashes can be recomputed without the payload: about 110 bytes per
+// block however large the payloads are.
+class HeaderIndex {
+  public:
+    [[nodiscard]] std::size_t size() const { return hashes_.size(); }
+    [[nodiscard]] bool empty() const { return hashes_.empty(); }
+    void reserve(std::size_t count);
+
+    // `header.index` must equal size().
+    void append(const BlockHeader& header, const Hash256& hash, const Hash256& payload_digest);
+    // Drops the headers at `height` and above.
+    void truncate(std::size_t height);
+
+    [[nodiscard]] BlockHeader header(std::size_t height) const;
+    [[nodiscard]] std::uint64_t timestamp(std::size_t height) const { return timestamps_[height]; }
+    [[nodiscard]] const Hash256& hash(std::size_t height) const { return hashes_[height]; }
+    [[nodiscard]] const Hash256& previous_hash(std::size_t height) const { return previous_hashes_[height]; }
+    [[nodiscard]] const Hash256& payload_digest(std::size_t height) const { return payload_digests_[height]; }
+
+    // Height of the block with this hash, if it is indexed.
+    [[nodiscard]] std::optional<std::size_t> find(const Hash256& hash) const;
+    [[nodiscard]] bool contains(const Hash256& hash) const { return find(hash).has_value(); }
+
+    // Recomputes the hashes of headers [first, last) from the stored fields, batched like compute_hashes.
+    [[nodiscard]] std::vector<Hash256> compute_hashes(std::size_t first, std::size_t last) const;
+
+  private:
+    void insert_slot(std::size_t height);
+    void rehash(std::size_t capacity);
+
+    std::vector<std::uint64_t> timestamps_;
+    std::vector<Hash256> hashes_;
+    std::vector<Hash256> previous_hashes_;
+    std::vector<Hash256> payload_digests_;
+    // Linear probing over a power-of-two table kept at most half full; a slot holds height + 1, 0 is empty.
+    std::vector<std::uint32_t> slots_;
+};
+
+}  // namespace elit21
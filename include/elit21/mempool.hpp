@@ -1,26 +1,153 @@
 #pragma once
 
+#include "elit21/payload.hpp"
 #include "elit21/transaction.hpp"
 
 #include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace elit21 {
 
+// Block-template order for pending transactions: higher fee first, then lower nonce, then arrival order.
+struct MempoolPriority {
+    std::uint64_t fee;
+    std::uint64_t nonce;
+    std::uint64_t sequence;
+    Hash256 id;
+
+    friend bool operator<(const MempoolPriority& a, const MempoolPriority& b) {
+        if (a.fee != b.fee) {
+            return a.fee > b.fee;
+        }
+        if (a.nonce != b.nonce) {
+            return a.nonce < b.nonce;
+        }
+        return a.sequence < b.sequence;
+    }
+};
+
+enum class MempoolAdmission {
+    Added,
+    Invalid,
+    Duplicate,
+    ReplacementFeeTooLow,
+    Full,
+};
+
+struct MempoolStatistics {
+    // Pending transactions replaced by one from the same sender and nonce paying a higher fee.
+    std::uint64_t replaced{0};
+    // Cheapest pending transactions evicted to make room in a full pool.
+    std::uint64_t evicted{0};
+    // Transactions turned away because they did not outbid what they would replace or evict.
+    std::uint64_t rejected{0};
+};
+
+// Pending transactions indexed by id, with a priority set kept in MempoolPriority order as transactions come
+// and go. Not thread-safe; see ConcurrentMempool.
 class Mempool {
   public:
     explicit Mempool(std::size_t max_transactions = 10'000);
 
+    // A transaction with the same sender and nonce as a pending one replaces it if its fee is higher. When the
+    // pool is full, a transaction paying more than the lowest-priority pending one evicts it.
     void add(const Transaction& tx);
-    [[nodiscard]] bool contains(const std::string& tx_id) const;
+    // Same as add, reporting the outcome instead of throwing.
+    [[nodiscard]] MempoolAdmission try_add(const Transaction& tx);
+    [[nodiscard]] bool contains(const Hash256& tx_id) const;
     [[nodiscard]] std::size_t size() const;
+    // Up to `limit` transactions in priority order, except that each sender's go in nonce order and stop at the
+    // first nonce gap: a sender's next transaction competes only once its predecessor is taken. Costs
+    // O(senders + limit log senders); never touches the rest of the pool.
     [[nodiscard]] std::vector<Transaction> select_for_block(std::size_t limit) const;
+    // Same, and a sender's queue also stops before the first transaction whose amount plus fee, added to those
+    // already taken, exceeds the sender's balance. Senders missing from `balances` are skipped, so the result
+    // always commits against those balances.
+    [[nodiscard]] std::vector<Transaction> select_for_block(std::size_t limit,
+                                                            const std::map<std::string, std::uint64_t>& balances) const;
+    // Block template ranked by fee per byte, where a transaction's bytes are what it adds to a block payload.
+    // Fills at most `max_bytes` and `max_transactions` with the best-paying executable transactions, keeping
+    // select_for_block's per-sender nonce and balance rules; a transaction that does not fit stops its sender's
+    // queue, and the search gives up after kMaxTemplateMisses such misses in a row. Senders are ranked by their
+    // lowest-nonce transaction in an index kept up to date on every add and removal, so building a template
+    // only touches the transactions it returns and those it skips.
+    [[nodiscard]] std::vector<Transaction> block_template(std::size_t max_transactions,
+                                                          std::size_t max_bytes,
+                                                          const std::map<std::string, std::uint64_t>& balances) const;
+    // Same template into `selected`, as pointers into the pool that stay valid until it next changes. Non-const
+    // because it reuses the pool's own working heap: with a reused vector, building allocates nothing once the
+    // vectors have grown.
+    void block_template(std::size_t max_transactions,
+                        std::size_t max_bytes,
+                        const std::map<std::string, std::uint64_t>& balances,
+                        std::vector<const Transaction*>& selected);
     void remove_committed(const std::vector<Transaction>& committed);
+    void remove_committed(const std::vector<Hash256>& committed_ids);
+    [[nodiscard]] const MempoolStatistics& statistics() const { return statistics_; }
+
+    static constexpr std::size_t kMaxTemplateMisses = 1000;
 
   private:
+    struct Entry {
+        Transaction tx;
+        std::uint64_t sequence;
+        // PayloadBuilder::encoded_size of the transaction.
+        std::size_t bytes;
+    };
+
+    struct FeeRateKey {
+        std::uint64_t fee;
+        std::size_t bytes;
+        std::uint64_t sequence;
+        Hash256 id;
+    };
+    // Higher fee per byte first, compared exactly, then arrival order.
+    struct HigherFeeRate {
+        bool operator()(const FeeRateKey& a, const FeeRateKey& b) const;
+    };
+    // A sender's next transaction once its predecessor is in the template, with what the sender can still spend.
+    struct TemplateCandidate {
+        FeeRateKey key;
+        std::map<std::uint64_t, Hash256>::const_iterator position;
+        std::map<std::uint64_t, Hash256>::const_iterator end;
+        std::uint64_t budget;
+    };
+
+    [[nodiscard]] static MempoolPriority priority_of(const Hash256& id, const Entry& entry) {
+        return MempoolPriority{entry.tx.fee(), entry.tx.nonce(), entry.sequence, id};
+    }
+    [[nodiscard]] static FeeRateKey fee_rate_of(const Hash256& id, const Entry& entry) {
+        return FeeRateKey{entry.tx.fee(), entry.bytes, entry.sequence, id};
+    }
+    void erase(const Hash256& tx_id);
+    // Drop and restore a sender's entry in heads_by_fee_rate_ around changes to its queue.
+    void unindex_head(const std::string& sender);
+    void index_head(const std::string& sender);
+    [[nodiscard]] std::vector<Transaction> assemble(std::size_t limit,
+                                                    const std::map<std::string, std::uint64_t>* balances) const;
+    // block_template with the successor heap supplied by the caller.
+    void fill_template(std::size_t max_transactions,
+                       std::size_t max_bytes,
+                       const std::map<std::string, std::uint64_t>& balances,
+                       std::vector<const Transaction*>& selected,
+                       std::vector<TemplateCandidate>& successors) const;
+
     std::size_t max_transactions_;
-    std::vector<Transaction> transactions_;
+    std::unordered_map<Hash256, Entry> by_id_;
+    std::set<MempoolPriority> by_priority_;
+    // Per-sender queues: pending ids by nonce.
+    std::unordered_map<std::string, std::map<std::uint64_t, Hash256>> by_sender_;
+    // The lowest-nonce transaction of every sender.
+    std::set<FeeRateKey, HigherFeeRate> heads_by_fee_rate_;
+    // Heap of promoted successors, kept between non-const block_template calls for its capacity.
+    std::vector<TemplateCandidate> template_successors_;
+    std::uint64_t next_sequence_{0};
+    MempoolStatistics statistics_;
 };
 
 }  // namespace elit21
@@ -2,16 +2,51 @@
 
 #include "elit21/blockchain.hpp"
 #include "elit21/mempool.hpp"
+#include "elit21/payload.hpp"
 #include "elit21/wallet.hpp"
 #include "elit21/readiness.hpp"
+#include "elit21/seen_filter.hpp"
+#include "elit21/thread_pool.hpp"
 
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace elit21 {
 
+struct InitialDownloadReport {
+    std::size_t blocks{0};
+    std::size_t transactions{0};
+    std::uint64_t elapsed_microseconds{0};
+    double blocks_per_second{0.0};
+    double transactions_per_second{0.0};
+    // Set once the checkpoint block is linked and the deferred header pass has run.
+    bool checkpoint_reached{false};
+};
+
+// Outcome of one submission; Node::submit throws with describe(status) for anything but Accepted.
+enum class SubmitStatus {
+    Accepted,
+    AlreadySeen,
+    // Matched only by the seen filter's Bloom generations; see Node::submit.
+    ProbablySeen,
+    Invalid,
+    UnknownSender,
+    UnknownReceiver,
+    InvalidSignature,
+    InsufficientBalance,
+    Duplicate,
+    ReplacementFeeTooLow,
+    MempoolFull,
+};
+
+[[nodiscard]] const char* describe(SubmitStatus status);
+
 class Node {
   public:
     explicit Node(std::string preferred_codec = "RLE");
@@ -20,24 +55,94 @@ class Node {
     [[nodiscard]] Wallet& wallet(const std::string& address);
     [[nodiscard]] const Wallet& wallet(const std::string& address) const;
 
+    // Transactions already committed, or turned away as invalid, are refused from the seen filter before the
+    // signature check. A mismatched signature is not recorded: the id does not cover the signature. Past the
+    // filter's exact window a match is only probable and is refused as ProbablySeen, not AlreadySeen: a
+    // transaction never seen gets that status at about the configured false-positive rate (1e-6 by default)
+    // until two filter rotations forget the colliding bits, and a new memo or fee gives it a fresh id.
     void submit(const SignedTransaction& signed_tx);
+    // Same checks as submit for every transaction, with one status each instead of an exception. The lookups,
+    // signature and balance checks run on the submit pool when one is set; the seen filter and the mempool are
+    // then updated in batch order, consulting the filter again for ids the batch itself recorded, so the
+    // statuses match a loop over submit.
+    [[nodiscard]] std::vector<SubmitStatus> submit_batch(const std::vector<SignedTransaction>& batch);
+    // Threads for submit_batch; 0 or 1 checks on the calling thread.
+    void set_submit_threads(std::size_t threads);
     [[nodiscard]] std::size_t mempool_size() const;
 
+    // Replaces the seen filter, forgetting every id it held.
+    void set_seen_filter_policy(const SeenFilterPolicy& policy);
+    [[nodiscard]] SeenFilterStatistics seen_filter_statistics() const { return seen_.statistics(); }
+
+    // Best fee-per-byte template that commit_local_block accepts against current balances and that stays
+    // within the chain's transport block limit (see Mempool::block_template).
     [[nodiscard]] Block forge_block_from_mempool(std::size_t max_transactions);
+    // The block must extend the current tip; it is never left in the chain's orphan pool.
     void commit_local_block(const Block& block);
 
+    // Replays a trusted history up to `checkpoint` (see Blockchain::begin_initial_download). replay_blocks
+    // skips the per-transaction checks and the transport round trip for blocks up to the checkpoint and
+    // applies their wallet updates once per call; blocks above it go through commit_local_block. Like
+    // commit_local_block, each block must extend the tip, and its net wallet effect is checked before it is
+    // linked, so the updates always apply. When the deferred header
+    // pass rejects the history, the chain drops it and the wallet updates of every replayed block are undone
+    // before the error is rethrown. Replayed transactions leave the mempool once the history is validated.
+    void begin_initial_download(const AssumeValidCheckpoint& checkpoint);
+    void replay_blocks(const std::vector<Block>& blocks);
+    [[nodiscard]] InitialDownloadReport initial_download_progress() const;
+    InitialDownloadReport finish_initial_download();
+
     [[nodiscard]] const Blockchain& chain() const;
     [[nodiscard]] ReadinessReport readiness_report(std::size_t min_wallets = 2,
                                                    std::size_t max_mempool_threshold = 500,
                                                    std::size_t min_chain_height = 2) const;
 
   private:
-    [[nodiscard]] static std::string encode_transactions(const std::vector<Transaction>& txs);
     [[nodiscard]] static std::vector<Transaction> decode_transactions(const std::string& payload);
+    // One pass over the payload with from_chars; the views borrow from `payload`, and the vector holding
+    // them is the only allocation.
+    [[nodiscard]] static std::vector<TransactionView> decode_transaction_views(std::string_view payload);
+
+    // Net effect of a run of replayed blocks on one wallet.
+    struct WalletDelta {
+        std::uint64_t credit{0};
+        std::uint64_t debit{0};
+        std::uint64_t fees{0};
+    };
+
+    void apply_wallet_deltas(const std::map<std::string, WalletDelta>& deltas);
+    // Throws unless `block` links directly onto the tip, never through the orphan pool.
+    void require_tip_extension(const Block& block) const;
+    // The history replayed since begin_initial_download was validated: its effects are final.
+    void commit_download();
+    // The chain dropped that history: undo its wallet updates.
+    void revert_download();
+    // Transactions per submit_batch check task.
+    static constexpr std::size_t kSubmitSlice = 64;
+
+    // Everything submit checks that reads only wallets: validity, both parties, signature, balance.
+    [[nodiscard]] SubmitStatus check_submission(const SignedTransaction& signed_tx) const;
+    // AlreadySeen or ProbablySeen from the seen filter, Accepted when it has no match.
+    [[nodiscard]] SubmitStatus seen_status(const Hash256& tx_id);
+    // Records invalid transactions as seen and hands checked ones to the mempool.
+    SubmitStatus admit(const SignedTransaction& signed_tx, SubmitStatus checked);
+    // Drops committed transactions from the mempool and records them as seen.
+    void retire_committed(const std::vector<Hash256>& committed_ids);
 
     Blockchain blockchain_;
     Mempool mempool_;
+    SeenFilter seen_;
+    std::unique_ptr<ThreadPool> submit_pool_;
+    // Reused by every forge_block_from_mempool, so forging allocates only the returned block once these grow.
+    std::map<std::string, std::uint64_t> forge_balances_;
+    std::vector<const Transaction*> forge_template_;
+    PayloadBuilder payload_builder_;
     std::map<std::string, Wallet> wallets_;
+    InitialDownloadReport download_;
+    // Wallet updates applied, and transactions committed, by blocks replayed under assume-valid.
+    std::map<std::string, WalletDelta> download_deltas_;
+    std::vector<Hash256> download_committed_;
+    std::chrono::steady_clock::time_point download_start_;
 };
 
 }  // namespace elit21
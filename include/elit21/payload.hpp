@@ -0,0 +1,33 @@
+#pragma once
+
+#include "elit21/transaction.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace elit21 {
+
+// Writes a block payload: the transaction count, then each transaction as its serialized size and bytes, every
+// field closed by '\n'. The exact size is computed first and the payload is written into one buffer that is
+// kept between builds, so once it has grown to the largest payload seen, building allocates nothing.
+class PayloadBuilder {
+  public:
+    // Bytes one transaction adds to a payload, framing included.
+    [[nodiscard]] static std::size_t encoded_size(const Transaction& tx);
+
+    // Both return the builder's buffer, valid until the next build.
+    const std::string& build(const std::vector<const Transaction*>& txs);
+    const std::string& build(const std::vector<Transaction>& txs);
+
+    [[nodiscard]] std::size_t capacity() const { return buffer_.capacity(); }
+
+  private:
+    void begin(std::size_t count, std::size_t bytes);
+    void append(const Transaction& tx);
+    void append_number(std::size_t value);
+
+    std::string buffer_;
+};
+
+}  // namespace elit21
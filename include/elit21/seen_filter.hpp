@@ -0,0 +1,82 @@
+#pragma once
+
+#include "elit21/hash256.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_set>
+#include <vector>
+
+namespace elit21 {
+
+// Each of the two Bloom generations is sized for `expected_transactions` ids at half of
+// `false_positive_rate`, so a lookup over both stays within the configured rate. The last `exact_window`
+// ids are also kept exactly. `expected_transactions == 0` disables the filter.
+struct SeenFilterPolicy {
+    std::size_t expected_transactions{100'000};
+    double false_positive_rate{1e-6};
+    std::size_t exact_window{4096};
+};
+
+struct SeenFilterStatistics {
+    std::size_t memory_bytes{0};
+    std::size_t bits_per_generation{0};
+    std::size_t hash_functions{0};
+    double configured_false_positive_rate{0.0};
+    // From the current fill of both generations.
+    double estimated_false_positive_rate{0.0};
+    std::uint64_t inserted{0};
+    // Lookups that matched: in the exact window, or only in the Bloom generations.
+    std::uint64_t exact_hits{0};
+    std::uint64_t probable_hits{0};
+    // Times the older generation was dropped to make room.
+    std::uint64_t rotations{0};
+};
+
+// How a lookup matched: in the exact window, or only in the Bloom generations, which also match an id never
+// inserted at about the configured false-positive rate.
+enum class SeenMatch {
+    None,
+    Exact,
+    Probable,
+};
+
+// Fixed-memory record of recently seen transaction ids: a rolling Bloom filter of two generations, where the
+// older one is dropped once the newer holds `expected_transactions` ids, backed by an exact set of the most
+// recent ids. An id is remembered for at least `expected_transactions` further inserts; a lookup may report
+// an id never inserted at about the configured false-positive rate, never the reverse within that window.
+class SeenFilter {
+  public:
+    explicit SeenFilter(const SeenFilterPolicy& policy = {});
+
+    void insert(const Hash256& tx_id);
+    [[nodiscard]] SeenMatch match(const Hash256& tx_id);
+    [[nodiscard]] bool contains(const Hash256& tx_id) { return match(tx_id) != SeenMatch::None; }
+    void clear();
+
+    [[nodiscard]] const SeenFilterPolicy& policy() const { return policy_; }
+    [[nodiscard]] SeenFilterStatistics statistics() const;
+
+  private:
+    struct Generation {
+        std::vector<std::uint64_t> words;
+        std::size_t set_bits{0};
+        std::size_t entries{0};
+    };
+
+    void set_bits(Generation& generation, const Hash256& tx_id);
+    [[nodiscard]] bool test_bits(const Generation& generation, const Hash256& tx_id) const;
+    [[nodiscard]] double fill_false_positive_rate(const Generation& generation) const;
+
+    SeenFilterPolicy policy_;
+    std::size_t bits_{0};
+    std::size_t hash_functions_{0};
+    Generation current_;
+    Generation previous_;
+    std::deque<Hash256> window_;
+    std::unordered_set<Hash256> window_ids_;
+    SeenFilterStatistics statistics_;
+};
+
+}  // namespace elit21
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace elit21 {
+
+using Digest256 = std::array<std::uint8_t, 32>;
+
+// Incremental SHA-256. Callers feed fields one by one instead of building a concatenated seed string;
+// the typed helpers use the same encodings as the binary wire format so a digest can cover a record
+// without serializing it.
+class Sha256 {
+  public:
+    Sha256();
+
+    Sha256& update(const void* data, std::size_t size);
+    Sha256& update(std::string_view bytes) { return update(bytes.data(), bytes.size()); }
+    Sha256& update_u32(std::uint32_t value);
+    Sha256& update_u64(std::uint64_t value);
+    // Varint length followed by the bytes, as in wire::put_bytes.
+    Sha256& update_sized(std::string_view bytes);
+
+    [[nodiscard]] Digest256 finish();
+
+  private:
+    std::array<std::uint32_t, 8> state_;
+    std::array<unsigned char, 64> buffer_{};
+    std::size_t buffered_{0};
+    std::uint64_t total_bytes_{0};
+};
+
+[[nodiscard]] Digest256 sha256(std::string_view bytes);
+[[nodiscard]] Digest256 hmac_sha256(std::string_view key, std::string_view message);
+
+// Hashes `count` independent messages. On AVX2 hardware eight messages are compressed side by side, one per
+// 32-bit lane; messages of similar length (headers, transactions) keep every lane busy.
+void sha256_batch(const std::string_view* messages, std::size_t count, Digest256* digests);
+
+[[nodiscard]] std::string to_hex(const Digest256& digest);
+
+// Kernels picked at startup for single messages ("sha-ni" or "scalar") and for batches ("avx2x8", "sha-ni"
+// or "scalar").
+[[nodiscard]] std::string sha256_backend();
+[[nodiscard]] std::string sha256_batch_backend();
+
+}  // namespace elit21
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace elit21 {
+
+// Fixed set of workers, each with its own task deque. A worker drains its own deque from the front and, once
+// empty, steals from the back of the others, so uneven tasks still finish together.
+class ThreadPool {
+  public:
+    using Task = std::function<void(std::size_t task, std::size_t worker)>;
+
+    explicit ThreadPool(std::size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    [[nodiscard]] std::size_t size() const { return workers_.size(); }
+
+    // Runs task(i, worker) for every i in [0, count) and returns once all have finished. The first exception
+    // thrown by a task is rethrown here. Concurrent callers are serialized.
+    void parallel_for(std::size_t count, const Task& task);
+
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    void run_worker(std::size_t worker);
+    bool next_task(std::size_t worker, std::size_t& task);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex run_mutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const Task* job_{nullptr};
+    std::uint64_t generation_{0};
+    std::size_t active_workers_{0};
+    std::atomic<std::size_t> remaining_{0};
+    std::exception_ptr error_;
+    bool stopping_{false};
+};
+
+}  // namespace elit21
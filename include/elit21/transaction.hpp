@@ -1,23 +1,105 @@
 #pragma once
 
+#include "elit21/hash256.hpp"
+
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace elit21 {
 
-struct Transaction {
-    std::string from;
-    std::string to;
-    std::uint64_t amount{0};
-    std::uint64_t fee{0};
-    std::uint64_t nonce{0};
-    std::string memo;
+inline constexpr std::string_view kTransactionMagic = "E21T";
+inline constexpr std::uint8_t kTransactionFormatVersion = 1;
+
+// A transfer with its identity cached alongside. Built from fields or deserialized, a transaction carries
+// its id from the start; a setter drops the cached id and the next id() call recomputes it, so mutate and
+// read id() on one thread before sharing the transaction.
+class Transaction {
+  public:
+    Transaction() = default;
+    Transaction(std::string from,
+                std::string to,
+                std::uint64_t amount,
+                std::uint64_t fee,
+                std::uint64_t nonce,
+                std::string memo = {});
+
+    [[nodiscard]] const std::string& from() const { return from_; }
+    [[nodiscard]] const std::string& to() const { return to_; }
+    [[nodiscard]] std::uint64_t amount() const { return amount_; }
+    [[nodiscard]] std::uint64_t fee() const { return fee_; }
+    [[nodiscard]] std::uint64_t nonce() const { return nonce_; }
+    [[nodiscard]] const std::string& memo() const { return memo_; }
+
+    void set_from(std::string from);
+    void set_to(std::string to);
+    void set_amount(std::uint64_t amount);
+    void set_fee(std::uint64_t fee);
+    void set_nonce(std::uint64_t nonce);
+    void set_memo(std::string memo);
 
-    [[nodiscard]] std::string id() const;
+    // SHA-256 of the fields in wire encoding, computed once per set of field values.
+    [[nodiscard]] const Hash256& id() const;
+    // Binary wire format: magic, version, from and to as varint-length strings, u64 amount, fee and nonce
+    // (little-endian), then the memo.
     [[nodiscard]] std::string serialize() const;
-    static Transaction deserialize(const std::string& raw);
+    // Exact size of serialize(), and the same bytes appended to `out`.
+    [[nodiscard]] std::size_t serialized_size() const;
+    void serialize_to(std::string& out) const;
+    [[nodiscard]] std::string serialize_text() const;
+    // Accepts both the binary and the legacy text format, then checks is_valid_transaction.
+    static Transaction deserialize(std::string_view raw);
+
+  private:
+    friend std::vector<Hash256> transaction_ids(const std::vector<Transaction>& txs);
+
+    [[nodiscard]] Hash256 compute_id() const;
+
+    std::string from_;
+    std::string to_;
+    std::uint64_t amount_{0};
+    std::uint64_t fee_{0};
+    std::uint64_t nonce_{0};
+    std::string memo_;
+    mutable Hash256 id_;
+    mutable bool has_id_{false};
+};
+
+// Parses a serialized transaction (either format) in place without semantic checks. The view borrows
+// from `raw`, which must outlive it.
+class TransactionView {
+  public:
+    [[nodiscard]] static TransactionView parse(std::string_view raw);
+
+    [[nodiscard]] std::string_view from() const { return from_; }
+    [[nodiscard]] std::string_view to() const { return to_; }
+    [[nodiscard]] std::uint64_t amount() const { return amount_; }
+    [[nodiscard]] std::uint64_t fee() const { return fee_; }
+    [[nodiscard]] std::uint64_t nonce() const { return nonce_; }
+    [[nodiscard]] std::string_view memo() const { return memo_; }
+
+    // Same value as Transaction::id, hashed straight from the borrowed fields.
+    [[nodiscard]] Hash256 id() const;
+    [[nodiscard]] Transaction to_transaction() const;
+
+  private:
+    [[nodiscard]] static TransactionView parse_binary(std::string_view raw);
+    [[nodiscard]] static TransactionView parse_text(std::string_view raw);
+
+    std::string_view from_;
+    std::string_view to_;
+    std::uint64_t amount_{0};
+    std::uint64_t fee_{0};
+    std::uint64_t nonce_{0};
+    std::string_view memo_;
 };
 
+// Transaction::id for every transaction; ids not cached yet are hashed together through sha256_batch and
+// cached.
+[[nodiscard]] std::vector<Hash256> transaction_ids(const std::vector<Transaction>& txs);
 [[nodiscard]] bool is_valid_transaction(const Transaction& tx);
+[[nodiscard]] bool is_valid_transaction(const TransactionView& view);
 
 }  // namespace elit21
@@ -9,7 +9,7 @@ namespace elit21 {
 
 struct SignedTransaction {
     Transaction tx;
-    std::string signature;
+    Hash256 signature;
 };
 
 class Wallet {
@@ -32,7 +32,7 @@ class Wallet {
     [[nodiscard]] bool verify_signature(const SignedTransaction& signed_tx) const;
 
   private:
-    [[nodiscard]] std::string sign(const Transaction& tx) const;
+    [[nodiscard]] Hash256 sign(const Transaction& tx) const;
 
     std::string address_;
     std::string secret_;
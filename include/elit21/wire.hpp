@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Little-endian primitives of the binary block/transaction format: fixed-width integers for numeric
+// fields and LEB128 varints for byte-string lengths.
+namespace elit21::wire {
+
+inline void put_u8(std::string& out, std::uint8_t value) {
+    out.push_back(static_cast<char>(value));
+}
+
+inline void put_u32(std::string& out, std::uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFFU));
+    }
+}
+
+inline void put_u64(std::string& out, std::uint64_t value) {
+    for (int shift = 0; shift < 64; shift += 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFFU));
+    }
+}
+
+inline void put_varint(std::string& out, std::uint64_t value) {
+    while (value >= 0x80U) {
+        out.push_back(static_cast<char>((value & 0x7FU) | 0x80U));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline void put_bytes(std::string& out, std::string_view bytes) {
+    put_varint(out, bytes.size());
+    out.append(bytes);
+}
+
+[[nodiscard]] inline std::size_t varint_size(std::uint64_t value) {
+    std::size_t size = 1;
+    while (value >= 0x80U) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+// Bounds-checked cursor over an encoded record. Failures throw "<context><field>", e.g. "invalid block: hash".
+class Reader {
+  public:
+    Reader(std::string_view data, const char* context) : data_(data), context_(context) {}
+
+    [[nodiscard]] bool at_end() const { return cursor_ == data_.size(); }
+
+    std::string_view take(std::size_t size, const char* field) {
+        if (data_.size() - cursor_ < size) {
+            fail(field);
+        }
+        const auto out = data_.substr(cursor_, size);
+        cursor_ += size;
+        return out;
+    }
+
+    std::uint8_t u8(const char* field) { return static_cast<std::uint8_t>(take(1, field)[0]); }
+
+    std::uint32_t u32(const char* field) {
+        const auto bytes = take(4, field);
+        std::uint32_t value = 0;
+        for (std::size_t i = 0; i < 4; ++i) {
+            value |= static_cast<std::uint32_t>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    std::uint64_t u64(const char* field) {
+        const auto bytes = take(8, field);
+        std::uint64_t value = 0;
+        for (std::size_t i = 0; i < 8; ++i) {
+            value |= static_cast<std::uint64_t>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    std::uint64_t varint(const char* field) {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const auto byte = u8(field);
+            if (shift == 63 && byte > 1) {
+                fail(field);
+            }
+            value |= static_cast<std::uint64_t>(byte & 0x7FU) << shift;
+            if ((byte & 0x80U) == 0) {
+                return value;
+            }
+        }
+        fail(field);
+    }
+
+    std::string_view bytes(const char* field) {
+        const auto size = varint(field);
+        if (size > data_.size() - cursor_) {
+            fail(field);
+        }
+        return take(static_cast<std::size_t>(size), field);
+    }
+
+    [[noreturn]] void fail(const char* field) const { throw std::runtime_error(std::string(context_) + field); }
+
+  private:
+    std::string_view data_;
+    const char* context_;
+    std::size_t cursor_{0};
+};
+
+}  // namespace elit21::wire
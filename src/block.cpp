@@ -1,29 +1,94 @@
 #include "elit21/block.hpp"
 
+#include "elit21/sha256.hpp"
+#include "elit21/wire.hpp"
+
+#include <charconv>
 #include <cstddef>
-#include <functional>
+#include <limits>
 #include <sstream>
 #include <stdexcept>
 
 namespace elit21 {
 
 std::string Block::serialize() const {
+    std::string out;
+    out.reserve(kBlockMagic.size() + 1 + 4 + 8 + 2 * Hash256::kSize + wire::varint_size(payload.size()) +
+                payload.size());
+    out.append(kBlockMagic);
+    wire::put_u8(out, kBlockFormatVersion);
+    wire::put_u32(out, header.index);
+    wire::put_u64(out, header.timestamp);
+    out.append(header.previous_hash.bytes());
+    wire::put_bytes(out, payload);
+    out.append(hash.bytes());
+    return out;
+}
+
+std::string Block::serialize_text() const {
     std::ostringstream os;
     os << header.index << '|'
        << header.timestamp << '|'
-       << header.previous_hash.size() << '|'
-       << header.previous_hash << '|'
+       << 2 * Hash256::kSize << '|'
+       << header.previous_hash.to_hex() << '|'
        << payload.size() << '|'
        << payload << '|'
-       << hash;
+       << hash.to_hex();
     return os.str();
 }
 
-Block Block::deserialize(const std::string& raw) {
+Block Block::deserialize(std::string_view raw) {
+    return BlockView::parse(raw).to_block();
+}
+
+BlockView BlockView::parse(std::string_view raw) {
+    if (raw.substr(0, kBlockMagic.size()) == kBlockMagic) {
+        return parse_binary(raw);
+    }
+    return parse_text(raw);
+}
+
+Block BlockView::to_block() const {
+    Block block;
+    block.header.index = index_;
+    block.header.timestamp = timestamp_;
+    block.header.previous_hash = previous_hash_;
+    block.payload = std::string(payload_);
+    block.hash = hash_;
+    return block;
+}
+
+BlockView BlockView::parse_binary(std::string_view raw) {
+    wire::Reader reader(raw.substr(kBlockMagic.size()), "invalid block: ");
+    const auto version = reader.u8("version");
+    if (version != 1 && version != kBlockFormatVersion) {
+        reader.fail("version");
+    }
+    const auto read_hash = [&](const char* field) {
+        const auto bytes = version == 1 ? reader.bytes(field) : reader.take(Hash256::kSize, field);
+        if (bytes.size() != Hash256::kSize) {
+            reader.fail(field);
+        }
+        return Hash256::from_bytes(bytes);
+    };
+
+    BlockView view;
+    view.index_ = reader.u32("index");
+    view.timestamp_ = reader.u64("timestamp");
+    view.previous_hash_ = read_hash("previous_hash");
+    view.payload_ = reader.bytes("payload");
+    view.hash_ = read_hash("hash");
+    if (!reader.at_end()) {
+        reader.fail("hash");
+    }
+    return view;
+}
+
+BlockView BlockView::parse_text(std::string_view raw) {
     std::size_t cursor = 0;
     auto consume_token = [&](const char* field_name) {
         const auto separator = raw.find('|', cursor);
-        if (separator == std::string::npos) {
+        if (separator == std::string_view::npos) {
             throw std::runtime_error(std::string("invalid block: ") + field_name);
         }
         const auto token = raw.substr(cursor, separator - cursor);
@@ -31,12 +96,22 @@ Block Block::deserialize(const std::string& raw) {
         return token;
     };
 
-    auto consume_sized_field = [&](const std::size_t size, const char* field_name) {
-        if (raw.size() - cursor < size + 1) {
+    auto consume_number = [&](const char* field_name) {
+        const auto token = consume_token(field_name);
+        std::uint64_t value = 0;
+        const auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+        if (error != std::errc() || end != token.data() + token.size() || token.empty()) {
+            throw std::runtime_error(std::string("invalid block: ") + field_name);
+        }
+        return value;
+    };
+
+    auto consume_sized_field = [&](const std::uint64_t size, const char* field_name) {
+        if (raw.size() - cursor <= size) {
             throw std::runtime_error(std::string("invalid block: ") + field_name);
         }
-        const auto token = raw.substr(cursor, size);
-        cursor += size;
+        const auto token = raw.substr(cursor, static_cast<std::size_t>(size));
+        cursor += static_cast<std::size_t>(size);
         if (raw[cursor] != '|') {
             throw std::runtime_error(std::string("invalid block: ") + field_name);
         }
@@ -44,40 +119,84 @@ Block Block::deserialize(const std::string& raw) {
         return token;
     };
 
-    std::string token;
-    Block block;
+    BlockView view;
 
-    token = consume_token("index");
-    block.header.index = static_cast<std::uint32_t>(std::stoul(token));
+    const auto index = consume_number("index");
+    if (index > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("invalid block: index");
+    }
+    view.index_ = static_cast<std::uint32_t>(index);
+    view.timestamp_ = consume_number("timestamp");
 
-    token = consume_token("timestamp");
-    block.header.timestamp = static_cast<std::uint64_t>(std::stoull(token));
+    const auto hex_field = [&](std::string_view token, const char* field_name) {
+        try {
+            return Hash256::from_hex(token);
+        } catch (const std::runtime_error&) {
+            throw std::runtime_error(std::string("invalid block: ") + field_name);
+        }
+    };
 
-    token = consume_token("previous_hash_size");
-    const auto previous_hash_size = static_cast<std::size_t>(std::stoull(token));
-    block.header.previous_hash = consume_sized_field(previous_hash_size, "previous_hash");
+    const auto previous_hash_size = consume_number("previous_hash_size");
+    view.previous_hash_ = hex_field(consume_sized_field(previous_hash_size, "previous_hash"), "previous_hash");
 
-    token = consume_token("payload_size");
-    const auto payload_size = static_cast<std::size_t>(std::stoull(token));
-    block.payload = consume_sized_field(payload_size, "payload");
+    const auto payload_size = consume_number("payload_size");
+    view.payload_ = consume_sized_field(payload_size, "payload");
 
-    if (cursor >= raw.size()) {
-        throw std::runtime_error("invalid block: hash");
-    }
-    block.hash = raw.substr(cursor);
-    if (block.hash.empty()) {
-        throw std::runtime_error("invalid block: hash");
-    }
+    view.hash_ = hex_field(raw.substr(cursor), "hash");
 
-    return block;
+    return view;
+}
+
+Hash256 compute_hash(const BlockHeader& header, const std::string& payload) {
+    return compute_hash(header, Hash256(sha256(payload)));
+}
+
+Hash256 compute_hash(const BlockHeader& header, const Hash256& payload_digest) {
+    return Hash256(Sha256()
+                       .update_u32(header.index)
+                       .update_u64(header.timestamp)
+                       .update(header.previous_hash.bytes())
+                       .update(payload_digest.bytes())
+                       .finish());
+}
+
+void append_header_preimage(std::string& out, const BlockHeader& header, const Hash256& payload_digest) {
+    wire::put_u32(out, header.index);
+    wire::put_u64(out, header.timestamp);
+    out.append(header.previous_hash.bytes());
+    out.append(payload_digest.bytes());
 }
 
-std::string compute_hash(const BlockHeader& header, const std::string& payload) {
-    const std::string seed = std::to_string(header.index) +
-                             std::to_string(header.timestamp) +
-                             header.previous_hash +
-                             payload;
-    return std::to_string(std::hash<std::string>{}(seed));
+std::vector<Hash256> compute_hashes(const std::vector<Block>& blocks) {
+    return compute_hashes(blocks.data(), blocks.size());
+}
+
+std::vector<Hash256> compute_hashes(const Block* blocks, std::size_t count) {
+    std::vector<std::string_view> messages;
+    messages.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        messages.emplace_back(blocks[i].payload);
+    }
+    std::vector<Digest256> digests(count);
+    sha256_batch(messages.data(), messages.size(), digests.data());
+
+    // Header preimages all have the same size, which keeps every lane of the batch kernel busy.
+    std::string preimages;
+    preimages.reserve(count * kHeaderPreimageBytes);
+    for (std::size_t i = 0; i < count; ++i) {
+        append_header_preimage(preimages, blocks[i].header, Hash256(digests[i]));
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        messages[i] = std::string_view(preimages).substr(i * kHeaderPreimageBytes, kHeaderPreimageBytes);
+    }
+    sha256_batch(messages.data(), messages.size(), digests.data());
+
+    std::vector<Hash256> hashes;
+    hashes.reserve(count);
+    for (const auto& digest : digests) {
+        hashes.emplace_back(digest);
+    }
+    return hashes;
 }
 
 }  // namespace elit21
@@ -0,0 +1,405 @@
+#include "elit21/block_store.hpp"
+
+#include "elit21/wire.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace elit21 {
+
+namespace {
+
+constexpr char kIndexMagic[8] = {'E', '2', '1', 'I', 'D', 'X', '0', '2'};
+constexpr std::size_t kIndexHeaderBytes = sizeof(kIndexMagic);
+// u32 segment, u32 size, u64 offset, u64 timestamp, 32-byte hash, 32-byte payload digest.
+constexpr std::size_t kIndexEntryBytes = 4 + 4 + 8 + 8 + 2 * Hash256::kSize;
+// Entries appended since the last mapping are kept in memory; past this many the index is mapped again.
+constexpr std::size_t kRemapEntries = 64 * 1024;
+
+[[noreturn]] void fail_io(const char* what) {
+    throw std::runtime_error(std::string("block store: ") + what + ": " + std::strerror(errno));
+}
+
+std::filesystem::path segment_path(const std::filesystem::path& directory, std::uint32_t segment) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "blk%05u.dat", segment);
+    return directory / name;
+}
+
+void write_all(int fd, const void* data, std::size_t size, std::uint64_t offset) {
+    const auto* bytes = static_cast<const char*>(data);
+    while (size != 0) {
+        const auto written = ::pwrite(fd, bytes, size, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fail_io("write failed");
+        }
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+        offset += static_cast<std::uint64_t>(written);
+    }
+}
+
+void read_all(int fd, void* data, std::size_t size, std::uint64_t offset) {
+    auto* bytes = static_cast<char*>(data);
+    while (size != 0) {
+        const auto got = ::pread(fd, bytes, size, static_cast<off_t>(offset));
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fail_io("read failed");
+        }
+        if (got == 0) {
+            throw std::runtime_error("block store: truncated segment");
+        }
+        bytes += got;
+        size -= static_cast<std::size_t>(got);
+        offset += static_cast<std::uint64_t>(got);
+    }
+}
+
+std::uint64_t file_size(int fd) {
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        fail_io("stat failed");
+    }
+    return static_cast<std::uint64_t>(info.st_size);
+}
+
+}  // namespace
+
+BlockStore::BlockStore(const std::filesystem::path& directory, std::uint64_t max_segment_bytes)
+    : directory_(directory), max_segment_bytes_(max_segment_bytes) {
+    if (max_segment_bytes_ == 0) {
+        throw std::runtime_error("block store segment size must be > 0");
+    }
+    std::filesystem::create_directories(directory_);
+
+    index_fd_ = ::open((directory_ / "index.dat").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (index_fd_ < 0) {
+        fail_io("cannot open index");
+    }
+    auto bytes = file_size(index_fd_);
+    if (bytes < kIndexHeaderBytes) {
+        if (::ftruncate(index_fd_, 0) != 0) {
+            fail_io("cannot reset index");
+        }
+        write_all(index_fd_, kIndexMagic, sizeof(kIndexMagic), 0);
+        bytes = kIndexHeaderBytes;
+    } else {
+        char magic[sizeof(kIndexMagic)];
+        read_all(index_fd_, magic, sizeof(magic), 0);
+        if (std::memcmp(magic, kIndexMagic, sizeof(magic)) != 0) {
+            close_all();
+            throw std::runtime_error("block store: invalid index file");
+        }
+    }
+
+    try {
+        map_index(static_cast<std::size_t>(bytes));
+        recover((mapped_bytes_ - kIndexHeaderBytes) / kIndexEntryBytes);
+
+        validated_fd_ = ::open((directory_ / "validated.dat").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (validated_fd_ < 0) {
+            fail_io("cannot open validated height");
+        }
+        // A missing or short file predates the watermark: nothing stored counts as validated.
+        if (file_size(validated_fd_) >= sizeof(std::uint64_t)) {
+            char raw[sizeof(std::uint64_t)];
+            read_all(validated_fd_, raw, sizeof(raw), 0);
+            wire::Reader reader(std::string_view(raw, sizeof(raw)), "block store: invalid ");
+            validated_height_ = static_cast<std::size_t>(std::min<std::uint64_t>(reader.u64("validated height"), size()));
+        }
+    } catch (...) {
+        close_all();
+        throw;
+    }
+}
+
+BlockStore::~BlockStore() {
+    try {
+        sync();
+    } catch (const std::runtime_error&) {
+        // Unsynced blocks are lost as in a crash; the next open recovers the synced prefix.
+    }
+    close_all();
+}
+
+void BlockStore::close_all() {
+    if (mapped_ != nullptr) {
+        ::munmap(const_cast<unsigned char*>(mapped_), mapped_bytes_);
+        mapped_ = nullptr;
+    }
+    for (const auto fd : segment_fds_) {
+        ::close(fd);
+    }
+    segment_fds_.clear();
+    if (validated_fd_ >= 0) {
+        ::close(validated_fd_);
+        validated_fd_ = -1;
+    }
+    if (index_fd_ >= 0) {
+        ::close(index_fd_);
+        index_fd_ = -1;
+    }
+}
+
+void BlockStore::map_index(std::size_t bytes) {
+    if (mapped_ != nullptr) {
+        ::munmap(const_cast<unsigned char*>(mapped_), mapped_bytes_);
+        mapped_ = nullptr;
+    }
+    void* mapping = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, index_fd_, 0);
+    if (mapping == MAP_FAILED) {
+        fail_io("cannot map index");
+    }
+    mapped_ = static_cast<const unsigned char*>(mapping);
+    mapped_bytes_ = bytes;
+    mapped_count_ = (bytes - kIndexHeaderBytes) / kIndexEntryBytes;
+    appended_.clear();
+}
+
+void BlockStore::recover(std::size_t entries) {
+    // Segments are synced before their index entries are written, and entries are synced in batches of at most
+    // kMaxUnsyncedEntries, so only that many trailing entries can be torn by a crash. Keep the entries before
+    // the first torn one, then cut the segments back to the last indexed record.
+    std::vector<std::uint64_t> segment_sizes;
+    const auto segment_size = [&](std::uint32_t segment) -> std::uint64_t {
+        while (segment_sizes.size() <= segment) {
+            std::error_code error;
+            const auto size = std::filesystem::file_size(segment_path(directory_, static_cast<std::uint32_t>(segment_sizes.size())), error);
+            segment_sizes.push_back(error ? 0 : static_cast<std::uint64_t>(size));
+        }
+        return segment_sizes[segment];
+    };
+    for (auto i = entries - std::min(entries, kMaxUnsyncedEntries); i < entries; ++i) {
+        const auto candidate = entry(i);
+        if (candidate.size == 0 || candidate.offset + candidate.size > segment_size(candidate.segment)) {
+            entries = i;
+            break;
+        }
+    }
+    // A torn entry can still look plausible; the record it points to settles it.
+    const auto record_matches = [&](std::size_t height) {
+        const auto located = entry(height);
+        const auto fd = ::open(segment_path(directory_, located.segment).c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        bool matches = false;
+        try {
+            std::string record(located.size, '\0');
+            read_all(fd, record.data(), record.size(), located.offset);
+            const auto block = Block::deserialize(record);
+            matches = block.header.index == height && block.hash == located.hash;
+        } catch (const std::exception&) {
+        }
+        ::close(fd);
+        return matches;
+    };
+    while (entries != 0 && !record_matches(entries - 1)) {
+        --entries;
+    }
+
+    const auto valid_bytes = kIndexHeaderBytes + entries * kIndexEntryBytes;
+    if (valid_bytes != mapped_bytes_) {
+        if (::ftruncate(index_fd_, static_cast<off_t>(valid_bytes)) != 0) {
+            fail_io("cannot truncate index");
+        }
+        map_index(valid_bytes);
+    }
+
+    std::uint32_t segments = 0;
+    if (entries != 0) {
+        const auto last = entry(entries - 1);
+        segments = last.segment + 1;
+        tail_bytes_ = last.offset + last.size;
+    }
+    for (std::uint32_t segment = 0; segment < segments; ++segment) {
+        open_segment(segment);
+    }
+    if (segments != 0 && ::ftruncate(segment_fds_.back(), static_cast<off_t>(tail_bytes_)) != 0) {
+        fail_io("cannot truncate segment");
+    }
+    for (auto segment = segments;; ++segment) {
+        std::error_code error;
+        if (!std::filesystem::remove(segment_path(directory_, segment), error)) {
+            break;
+        }
+    }
+}
+
+void BlockStore::open_segment(std::uint32_t segment) {
+    const auto fd = ::open(segment_path(directory_, segment).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fail_io("cannot open segment");
+    }
+    segment_fds_.push_back(fd);
+}
+
+BlockStore::Entry BlockStore::entry(std::size_t height) const {
+    if (height >= mapped_count_) {
+        return appended_.at(height - mapped_count_);
+    }
+    const auto* raw = reinterpret_cast<const char*>(mapped_ + kIndexHeaderBytes + height * kIndexEntryBytes);
+    wire::Reader reader(std::string_view(raw, kIndexEntryBytes), "block store: invalid index ");
+    Entry out{};
+    out.segment = reader.u32("segment");
+    out.size = reader.u32("size");
+    out.offset = reader.u64("offset");
+    out.timestamp = reader.u64("timestamp");
+    out.hash = Hash256::from_bytes(reader.take(Hash256::kSize, "hash"));
+    out.payload_digest = Hash256::from_bytes(reader.take(Hash256::kSize, "payload digest"));
+    return out;
+}
+
+void BlockStore::append(const Block& block, const Hash256& payload_digest) {
+    if (block.header.index != size()) {
+        throw std::runtime_error("block store: non-sequential append");
+    }
+    const auto record = block.serialize();
+    if (segment_fds_.empty() || (tail_bytes_ != 0 && tail_bytes_ + record.size() > max_segment_bytes_)) {
+        open_segment(static_cast<std::uint32_t>(segment_fds_.size()));
+        tail_bytes_ = 0;
+    }
+
+    Entry added{};
+    added.segment = static_cast<std::uint32_t>(segment_fds_.size() - 1);
+    added.size = static_cast<std::uint32_t>(record.size());
+    added.offset = tail_bytes_;
+    added.timestamp = block.header.timestamp;
+    added.hash = block.hash;
+    added.payload_digest = payload_digest;
+    write_all(segment_fds_.back(), record.data(), record.size(), added.offset);
+
+    if (unsynced_ == 0) {
+        first_unsynced_segment_ = added.segment;
+    }
+    tail_bytes_ += record.size();
+    appended_.push_back(added);
+    ++unsynced_;
+    if (unsynced_ >= kMaxUnsyncedEntries) {
+        sync();
+    }
+}
+
+void BlockStore::sync() {
+    if (unsynced_ == 0) {
+        return;
+    }
+    // recover() trusts every index entry that points inside a segment, so the records must be durable first.
+    for (auto segment = first_unsynced_segment_; segment < segment_fds_.size(); ++segment) {
+        if (::fdatasync(segment_fds_[segment]) != 0) {
+            fail_io("cannot sync segment");
+        }
+    }
+
+    const auto first = size() - unsynced_;
+    std::string encoded;
+    encoded.reserve(unsynced_ * kIndexEntryBytes);
+    for (auto height = first; height < size(); ++height) {
+        const auto added = entry(height);
+        wire::put_u32(encoded, added.segment);
+        wire::put_u32(encoded, added.size);
+        wire::put_u64(encoded, added.offset);
+        wire::put_u64(encoded, added.timestamp);
+        encoded.append(added.hash.bytes());
+        encoded.append(added.payload_digest.bytes());
+    }
+    write_all(index_fd_, encoded.data(), encoded.size(), kIndexHeaderBytes + first * kIndexEntryBytes);
+    if (::fdatasync(index_fd_) != 0) {
+        fail_io("cannot sync index");
+    }
+    unsynced_ = 0;
+
+    if (appended_.size() >= kRemapEntries) {
+        map_index(kIndexHeaderBytes + size() * kIndexEntryBytes);
+    }
+}
+
+void BlockStore::truncate(std::size_t height) {
+    if (height >= size()) {
+        return;
+    }
+    sync();
+    set_validated_height(std::min(validated_height_, height));
+    for (const auto fd : segment_fds_) {
+        ::close(fd);
+    }
+    segment_fds_.clear();
+    tail_bytes_ = 0;
+    // Map every entry written so far, then cut the index and the segments back as a crash recovery would.
+    map_index(kIndexHeaderBytes + size() * kIndexEntryBytes);
+    recover(height);
+}
+
+void BlockStore::set_validated_height(std::size_t height) {
+    height = std::min(height, size());
+    if (height == validated_height_) {
+        return;
+    }
+    std::string encoded;
+    wire::put_u64(encoded, height);
+    write_all(validated_fd_, encoded.data(), encoded.size(), 0);
+    if (height < validated_height_ && ::fdatasync(validated_fd_) != 0) {
+        fail_io("cannot sync validated height");
+    }
+    validated_height_ = height;
+}
+
+Block BlockStore::read(std::size_t height) const {
+    const auto located = entry(height);
+    std::string record(located.size, '\0');
+    read_all(segment_fds_.at(located.segment), record.data(), record.size(), located.offset);
+    auto block = Block::deserialize(record);
+    if (block.header.index != height || block.hash != located.hash) {
+        throw std::runtime_error("block store: record does not match index");
+    }
+    return block;
+}
+
+std::vector<Block> BlockStore::read_range(std::size_t first, std::size_t last) const {
+    std::vector<Block> blocks;
+    blocks.reserve(last - first);
+    for (auto height = first; height < last; ++height) {
+        blocks.push_back(read(height));
+    }
+    return blocks;
+}
+
+BlockHeader BlockStore::header(std::size_t height) const {
+    BlockHeader out;
+    out.index = static_cast<std::uint32_t>(height);
+    out.timestamp = entry(height).timestamp;
+    if (height != 0) {
+        out.previous_hash = entry(height - 1).hash;
+    }
+    return out;
+}
+
+Hash256 BlockStore::hash(std::size_t height) const {
+    return entry(height).hash;
+}
+
+std::uint64_t BlockStore::timestamp(std::size_t height) const {
+    return entry(height).timestamp;
+}
+
+Hash256 BlockStore::payload_digest(std::size_t height) const {
+    return entry(height).payload_digest;
+}
+
+}  // namespace elit21
@@ -1,20 +1,75 @@
 #include "elit21/blockchain.hpp"
 
+#include "elit21/sha256.hpp"
+
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <future>
 #include <stdexcept>
 #include <utility>
 
 namespace elit21 {
 
+namespace {
+
+constexpr std::size_t kAdaptiveSlices = 4;
+
+std::uint64_t elapsed_nanoseconds(std::chrono::steady_clock::time_point start) {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+std::uint64_t wall_clock_seconds() {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// Evenly spaced slices stand in for the whole block so that a codec's ratio on the header, the
+// transaction list and the tail all weigh in.
+std::string adaptive_sample(const std::string& raw_block, std::size_t sample_bytes) {
+    if (raw_block.size() <= sample_bytes) {
+        return raw_block;
+    }
+    const auto slice = std::max<std::size_t>(sample_bytes / kAdaptiveSlices, 1);
+    const auto stride = (raw_block.size() - slice) / (kAdaptiveSlices - 1);
+    std::string sample;
+    sample.reserve(slice * kAdaptiveSlices);
+    for (std::size_t i = 0; i < kAdaptiveSlices; ++i) {
+        sample.append(raw_block, i * stride, slice);
+    }
+    return sample;
+}
+
+}  // namespace
+
+struct Blockchain::CodecTelemetry {
+    struct Counters {
+        std::atomic<std::uint64_t> encoded_blocks{0};
+        std::atomic<std::uint64_t> encode_bytes_in{0};
+        std::atomic<std::uint64_t> encode_bytes_out{0};
+        std::atomic<std::uint64_t> encode_nanoseconds{0};
+        std::atomic<std::uint64_t> decoded_blocks{0};
+        std::atomic<std::uint64_t> decode_bytes_in{0};
+        std::atomic<std::uint64_t> decode_bytes_out{0};
+        std::atomic<std::uint64_t> decode_nanoseconds{0};
+    };
+
+    std::array<Counters, 256> by_id;
+
+    Counters& at(CodecId id) { return by_id[static_cast<std::size_t>(id)]; }
+};
+
 Blockchain::Blockchain(std::string preferred_codec,
                        std::size_t max_transport_block_bytes,
                        std::uint64_t max_future_drift_seconds)
-    : preferred_codec_(std::move(preferred_codec)),
+    : preferred_codec_(find_codec(preferred_codec)),
       max_transport_block_bytes_(max_transport_block_bytes),
-      max_future_drift_seconds_(max_future_drift_seconds) {
-    if (!is_supported_codec(preferred_codec_)) {
+      max_future_drift_seconds_(max_future_drift_seconds),
+      telemetry_(std::make_unique<CodecTelemetry>()) {
+    if (preferred_codec_ == nullptr) {
         throw std::runtime_error("unsupported preferred codec");
     }
     if (max_transport_block_bytes_ == 0) {
@@ -27,41 +82,296 @@ Blockchain::Blockchain(std::string preferred_codec,
     Block genesis;
     genesis.header.index = 0;
     genesis.header.timestamp = 0;
-    genesis.header.previous_hash = "GENESIS";
     genesis.payload = "ELIT21coin genesis";
-    genesis.hash = compute_hash(genesis.header, genesis.payload);
-    chain_.push_back(genesis);
+    const Hash256 payload_digest(sha256(genesis.payload));
+    genesis.hash = compute_hash(genesis.header, payload_digest);
+    headers_.append(genesis.header, genesis.hash, payload_digest);
+    resident_.push_back(genesis);
+    validated_height_ = 1;
+}
+
+Blockchain::~Blockchain() = default;
+Blockchain::Blockchain(Blockchain&&) noexcept = default;
+Blockchain& Blockchain::operator=(Blockchain&&) noexcept = default;
+
+Blockchain Blockchain::open(const std::filesystem::path& directory,
+                            std::string preferred_codec,
+                            std::size_t max_transport_block_bytes,
+                            std::uint64_t max_future_drift_seconds) {
+    Blockchain chain(std::move(preferred_codec), max_transport_block_bytes, max_future_drift_seconds);
+    chain.store_ = std::make_unique<BlockStore>(directory);
+    auto& store = *chain.store_;
+    if (store.size() == 0) {
+        store.append(chain.resident_.front(), chain.headers_.payload_digest(0));
+        store.sync();
+        store.set_validated_height(1);
+        return chain;
+    }
+    if (store.hash(0) != chain.headers_.hash(0)) {
+        throw std::runtime_error("block store genesis mismatch");
+    }
+    const auto stored = store.size();
+    chain.headers_.reserve(stored);
+    for (std::size_t h = 1; h < stored; ++h) {
+        chain.headers_.append(store.header(h), store.hash(h), store.payload_digest(h));
+    }
+    chain.resident_base_ = stored - std::min(stored, kResidentBlocks);
+    chain.resident_ = store.read_range(chain.resident_base_, stored);
+    // Blocks linked under assume-valid and never checked sit above the persisted watermark; genesis was just
+    // compared against ours.
+    chain.validated_height_ = std::max<std::size_t>(store.validated_height(), 1);
+    return chain;
+}
+
+std::size_t ChainView::size() const {
+    return chain_->height();
+}
+
+Block ChainView::operator[](std::size_t height) const {
+    return chain_->block_at(height);
+}
+
+std::vector<Block> ChainView::blocks(std::size_t first, std::size_t last) const {
+    return chain_->blocks(first, last);
+}
+
+Block Blockchain::block_at(std::size_t height) const {
+    if (height >= resident_base_) {
+        return resident_.at(height - resident_base_);
+    }
+    return store_->read(height);
+}
+
+std::vector<Block> Blockchain::blocks(std::size_t first, std::size_t last) const {
+    if (first > last || last > height()) {
+        throw std::runtime_error("chain range out of bounds");
+    }
+    if (first >= resident_base_) {
+        const auto begin = resident_.begin() + static_cast<std::ptrdiff_t>(first - resident_base_);
+        return std::vector<Block>(begin, begin + static_cast<std::ptrdiff_t>(last - first));
+    }
+    return store_->read_range(first, last);
+}
+
+std::optional<Block> Blockchain::find_block(const Hash256& hash) const {
+    const auto height = headers_.find(hash);
+    if (!height) {
+        return std::nullopt;
+    }
+    return block_at(*height);
 }
 
 Block Blockchain::create_block(const std::string& payload) const {
     Block block;
-    block.header.index = static_cast<std::uint32_t>(chain_.size());
+    block.header.index = static_cast<std::uint32_t>(height());
     block.header.timestamp = static_cast<std::uint64_t>(
         std::chrono::duration_cast<std::chrono::seconds>(
             std::chrono::system_clock::now().time_since_epoch())
             .count());
-    block.header.previous_hash = chain_.back().hash;
+    block.header.previous_hash = headers_.hash(height() - 1);
     block.payload = payload;
     block.hash = compute_hash(block.header, block.payload);
     return block;
 }
 
 CompressedBlock Blockchain::compress_for_transport(const Block& block) const {
-    return compress_block(block.serialize(), preferred_codec_);
+    return encode_for_transport(block.serialize(), *preferred_codec_);
 }
 
 CompressedBlock Blockchain::compress_for_transport(const Block& block, const std::vector<std::string>& peer_codecs) const {
-    return compress_block(block.serialize(), negotiate_codec(peer_codecs));
+    return compress_for_codec_ids(block, codec_ids(peer_codecs));
+}
+
+CompressedBlock Blockchain::compress_for_codec_ids(const Block& block, const std::vector<CodecId>& peer_codecs) const {
+    const auto raw_block = block.serialize();
+    if (!adaptive_policy_.enabled) {
+        return encode_for_transport(raw_block, negotiate_codec(peer_codecs));
+    }
+    auto out = encode_for_transport(raw_block, choose_adaptive_codec(raw_block, peer_codecs));
+    // The sample can misjudge a block; never ship something larger than the block itself.
+    if (out.bytes.size() > raw_block.size() && out.codec != CodecId::Raw &&
+        std::find(peer_codecs.begin(), peer_codecs.end(), CodecId::Raw) != peer_codecs.end()) {
+        out = encode_for_transport(raw_block, raw_codec());
+    }
+    return out;
+}
+
+CompressedBlock Blockchain::compress_for_transport(const Block& block,
+                                                   const std::vector<std::string>& peer_codecs,
+                                                   const std::vector<std::string>& peer_dictionaries) const {
+    const auto offered = codec_ids(peer_codecs);
+    if (!dictionaries_.empty() && std::find(offered.begin(), offered.end(), CodecId::LzDictionary) != offered.end()) {
+        for (auto it = dictionaries_.rbegin(); it != dictionaries_.rend(); ++it) {
+            const auto& id = it->dictionary->id();
+            if (std::find(peer_dictionaries.begin(), peer_dictionaries.end(), id) != peer_dictionaries.end()) {
+                auto out = encode_for_transport(block.serialize(), *it->codec);
+                out.dictionary_id = id;
+                return out;
+            }
+        }
+    }
+    return compress_for_codec_ids(block, offered);
 }
 
-std::string Blockchain::negotiate_codec(const std::vector<std::string>& peer_codecs) const {
-    if (std::find(peer_codecs.begin(), peer_codecs.end(), preferred_codec_) != peer_codecs.end()) {
-        return preferred_codec_;
+void Blockchain::set_adaptive_codec_policy(const AdaptiveCodecPolicy& policy) {
+    if (policy.enabled && policy.sample_bytes < kAdaptiveSlices) {
+        throw std::runtime_error("adaptive codec sample too small");
     }
+    if (policy.enabled && policy.max_encode_nanoseconds_per_kib == 0) {
+        throw std::runtime_error("adaptive codec budget must be > 0");
+    }
+    adaptive_policy_ = policy;
+}
 
-    for (const auto& codec : peer_codecs) {
-        if (is_supported_codec(codec)) {
-            return codec;
+std::vector<CodecStatistics> Blockchain::codec_statistics() const {
+    std::vector<CodecStatistics> statistics;
+    for (std::size_t id = 0; id < telemetry_->by_id.size(); ++id) {
+        const auto& counters = telemetry_->by_id[id];
+        CodecStatistics entry;
+        entry.encoded_blocks = counters.encoded_blocks.load(std::memory_order_relaxed);
+        entry.decoded_blocks = counters.decoded_blocks.load(std::memory_order_relaxed);
+        if (entry.encoded_blocks == 0 && entry.decoded_blocks == 0) {
+            continue;
+        }
+        const auto codec_id = static_cast<CodecId>(id);
+        if (const auto* codec = find_codec(codec_id)) {
+            entry.codec = std::string(codec->name());
+        } else if (codec_id == CodecId::LzDictionary) {
+            entry.codec = std::string(kDictionaryCodecName);
+        } else {
+            entry.codec = "codec-" + std::to_string(id);
+        }
+        entry.encode_bytes_in = counters.encode_bytes_in.load(std::memory_order_relaxed);
+        entry.encode_bytes_out = counters.encode_bytes_out.load(std::memory_order_relaxed);
+        entry.encode_nanoseconds = counters.encode_nanoseconds.load(std::memory_order_relaxed);
+        entry.decode_bytes_in = counters.decode_bytes_in.load(std::memory_order_relaxed);
+        entry.decode_bytes_out = counters.decode_bytes_out.load(std::memory_order_relaxed);
+        entry.decode_nanoseconds = counters.decode_nanoseconds.load(std::memory_order_relaxed);
+        statistics.push_back(std::move(entry));
+    }
+    return statistics;
+}
+
+CompressedBlock Blockchain::encode_for_transport(const std::string& raw_block, const BlockCodec& codec) const {
+    const auto start = std::chrono::steady_clock::now();
+    auto out = compress_block(raw_block, codec);
+    const auto nanoseconds = elapsed_nanoseconds(start);
+
+    auto& counters = telemetry_->at(codec.id());
+    counters.encoded_blocks.fetch_add(1, std::memory_order_relaxed);
+    counters.encode_bytes_in.fetch_add(raw_block.size(), std::memory_order_relaxed);
+    counters.encode_bytes_out.fetch_add(out.bytes.size(), std::memory_order_relaxed);
+    counters.encode_nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    return out;
+}
+
+const BlockCodec& Blockchain::choose_adaptive_codec(const std::string& raw_block,
+                                                    const std::vector<CodecId>& peer_codecs) const {
+    const auto sample = adaptive_sample(raw_block, adaptive_policy_.sample_bytes);
+    const auto sample_size = std::max<std::size_t>(sample.size(), 1);
+
+    // RAW needs no trial: it costs nothing and its size is the block's own.
+    const BlockCodec* best = nullptr;
+    double best_size = 0.0;
+    const BlockCodec* fastest = nullptr;
+    std::uint64_t fastest_cost = 0;
+    std::string trial;
+    for (const auto id : peer_codecs) {
+        const auto* codec = find_codec(id);
+        if (codec == nullptr) {
+            continue;
+        }
+        double estimated_size = static_cast<double>(raw_block.size());
+        std::uint64_t cost_per_kib = 0;
+        if (codec != &raw_codec()) {
+            const auto start = std::chrono::steady_clock::now();
+            codec->compress(sample, trial);
+            cost_per_kib = elapsed_nanoseconds(start) * 1024 / sample_size;
+            estimated_size = static_cast<double>(trial.size()) * static_cast<double>(raw_block.size()) /
+                             static_cast<double>(sample_size);
+        }
+        if (fastest == nullptr || cost_per_kib < fastest_cost) {
+            fastest = codec;
+            fastest_cost = cost_per_kib;
+        }
+        if (cost_per_kib > adaptive_policy_.max_encode_nanoseconds_per_kib) {
+            continue;
+        }
+        if (best == nullptr || estimated_size < best_size) {
+            best = codec;
+            best_size = estimated_size;
+        }
+    }
+
+    if (best != nullptr) {
+        return *best;
+    }
+    if (fastest != nullptr) {
+        return *fastest;
+    }
+    throw std::runtime_error("no mutually supported codec");
+}
+
+std::string Blockchain::train_dictionary(std::size_t recent_blocks, std::size_t max_bytes) {
+    if (recent_blocks == 0) {
+        throw std::runtime_error("dictionary training needs at least one block");
+    }
+    std::vector<std::string> samples;
+    const auto first = height() > recent_blocks ? height() - recent_blocks : 0;
+    for (auto i = first; i < height(); ++i) {
+        samples.push_back(block_at(i).serialize());
+    }
+    auto trained = CompressionDictionary::train(samples, max_bytes);
+    add_dictionary(trained);
+    return trained.id();
+}
+
+void Blockchain::add_dictionary(const CompressionDictionary& dictionary) {
+    if (find_dictionary(dictionary.id()) != nullptr) {
+        return;
+    }
+    if (dictionaries_.size() == kMaxDictionaries) {
+        dictionaries_.erase(dictionaries_.begin());
+    }
+    auto shared = std::make_shared<const CompressionDictionary>(dictionary);
+    auto codec = make_dictionary_codec(shared);
+    dictionaries_.push_back(SharedDictionary{std::move(shared), std::move(codec)});
+}
+
+std::vector<std::string> Blockchain::dictionary_ids() const {
+    std::vector<std::string> ids;
+    ids.reserve(dictionaries_.size());
+    for (const auto& entry : dictionaries_) {
+        ids.push_back(entry.dictionary->id());
+    }
+    return ids;
+}
+
+const CompressionDictionary& Blockchain::dictionary(const std::string& id) const {
+    const auto* entry = find_dictionary(id);
+    if (entry == nullptr) {
+        throw std::runtime_error("unknown compression dictionary");
+    }
+    return *entry->dictionary;
+}
+
+const Blockchain::SharedDictionary* Blockchain::find_dictionary(const std::string& id) const {
+    for (const auto& entry : dictionaries_) {
+        if (entry.dictionary->id() == id) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+const BlockCodec& Blockchain::negotiate_codec(const std::vector<CodecId>& peer_codecs) const {
+    if (std::find(peer_codecs.begin(), peer_codecs.end(), preferred_codec_->id()) != peer_codecs.end()) {
+        return *preferred_codec_;
+    }
+
+    for (const auto codec : peer_codecs) {
+        if (const auto* supported = find_codec(codec)) {
+            return *supported;
         }
     }
 
@@ -69,90 +379,410 @@ std::string Blockchain::negotiate_codec(const std::vector<std::string>& peer_cod
 }
 
 void Blockchain::accept_from_network(const CompressedBlock& compressed_block) {
+    begin_network_block(compressed_block.codec, compressed_block.version, compressed_block.dictionary_id);
+    feed_network_block(compressed_block.bytes);
+    finish_network_block();
+}
+
+void Blockchain::accept_batch(const std::vector<CompressedBlock>& compressed_blocks) {
+    // Two windows in flight: while the caller links window w, window w + 1 is decoded on another thread.
+    std::vector<PreparedBlock> current;
+    std::vector<PreparedBlock> ahead;
+    prepare_blocks(compressed_blocks, 0, current);
+    for (std::size_t first = 0; first < compressed_blocks.size(); first += kIngestWindow) {
+        std::future<void> next;
+        const auto next_first = first + kIngestWindow;
+        if (next_first < compressed_blocks.size()) {
+            next = std::async(std::launch::async, [this, &compressed_blocks, next_first, &ahead] {
+                prepare_blocks(compressed_blocks, next_first, ahead);
+            });
+        }
+        // The future's destructor joins the decoder before any linking error leaves this frame.
+        const auto now = wall_clock_seconds();
+        try {
+            for (auto& prepared : current) {
+                if (prepared.error) {
+                    std::rethrow_exception(prepared.error);
+                }
+                accept_block(std::move(prepared.block), prepared.payload_digest, prepared.computed_hash, now);
+            }
+        } catch (...) {
+            sync_store();
+            throw;
+        }
+        // One sync per window instead of one per block.
+        sync_store();
+        if (next.valid()) {
+            next.get();
+        }
+        std::swap(current, ahead);
+    }
+}
+
+void Blockchain::prepare_blocks(const std::vector<CompressedBlock>& compressed_blocks,
+                                std::size_t first,
+                                std::vector<PreparedBlock>& prepared) const {
+    const auto count = std::min(kIngestWindow, compressed_blocks.size() - first);
+    prepared.clear();
+    prepared.resize(count);
+    const auto prepare_slice = [&](std::size_t slice, std::size_t) {
+        const auto end = std::min((slice + 1) * kIngestSlice, count);
+        for (auto i = slice * kIngestSlice; i < end; ++i) {
+            const auto& compressed = compressed_blocks[first + i];
+            auto& out = prepared[i];
+            try {
+                std::shared_ptr<const BlockCodec> dictionary_codec;
+                const auto& codec = network_codec(compressed.codec, compressed.version, compressed.dictionary_id, dictionary_codec);
+                const auto start = std::chrono::steady_clock::now();
+                const auto raw = codec.decompress(compressed.bytes, max_transport_block_bytes_);
+                const auto nanoseconds = elapsed_nanoseconds(start);
+                record_decode(codec, compressed.bytes.size(), raw.size(), nanoseconds);
+                out.block = Block::deserialize(raw);
+                out.payload_digest = Hash256(sha256(out.block.payload));
+                out.computed_hash = compute_hash(out.block.header, out.payload_digest);
+            } catch (...) {
+                out.error = std::current_exception();
+            }
+        }
+    };
+    const auto slices = (count + kIngestSlice - 1) / kIngestSlice;
+    if (validation_pool_) {
+        validation_pool_->parallel_for(slices, prepare_slice);
+    } else {
+        for (std::size_t slice = 0; slice < slices; ++slice) {
+            prepare_slice(slice, 0);
+        }
+    }
+}
+
+const BlockCodec& Blockchain::network_codec(CodecId codec,
+                                            std::uint8_t version,
+                                            const std::string& dictionary_id,
+                                            std::shared_ptr<const BlockCodec>& dictionary_codec) const {
+    if (version != 1) {
+        throw std::runtime_error("unsupported compressed block version");
+    }
+    const BlockCodec* selected = nullptr;
+    if (dictionary_id.empty()) {
+        selected = find_codec(codec);
+    } else {
+        const auto* entry = find_dictionary(dictionary_id);
+        if (entry == nullptr) {
+            throw std::runtime_error("unknown compression dictionary");
+        }
+        dictionary_codec = entry->codec;
+        selected = dictionary_codec->id() == codec ? dictionary_codec.get() : nullptr;
+    }
+    if (selected == nullptr) {
+        throw std::runtime_error("unsupported codec");
+    }
+    return *selected;
+}
+
+void Blockchain::begin_network_block(CodecId codec, std::uint8_t version, const std::string& dictionary_id) {
+    network_block_open_ = false;
+    stream_codec_.reset();
+    stream_selected_ = nullptr;
+    stream_bytes_in_ = 0;
+    stream_nanoseconds_ = 0;
+    const auto& selected = network_codec(codec, version, dictionary_id, stream_codec_);
+    if (decode_arena_.size() < max_transport_block_bytes_) {
+        decode_arena_.resize(max_transport_block_bytes_);
+    }
+    decompressor_.reset(selected, decode_arena_.data(), max_transport_block_bytes_);
+    stream_selected_ = &selected;
+    network_block_open_ = true;
+}
+
+void Blockchain::feed_network_block(std::string_view chunk) {
+    if (!network_block_open_) {
+        throw std::runtime_error("no network block in progress");
+    }
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        decompressor_.feed(chunk);
+    } catch (...) {
+        network_block_open_ = false;
+        throw;
+    }
+    stream_bytes_in_ += chunk.size();
+    stream_nanoseconds_ += elapsed_nanoseconds(start);
+}
+
+void Blockchain::finish_network_block() {
+    if (!network_block_open_) {
+        throw std::runtime_error("no network block in progress");
+    }
+    network_block_open_ = false;
     const auto now = static_cast<std::uint64_t>(
         std::chrono::duration_cast<std::chrono::seconds>(
             std::chrono::system_clock::now().time_since_epoch())
             .count());
-    const auto raw = decompress_block(compressed_block, max_transport_block_bytes_);
-    const auto block = Block::deserialize(raw);
+    const auto start = std::chrono::steady_clock::now();
+    const auto size = decompressor_.finish();
+    record_decode(*stream_selected_, stream_bytes_in_, size, stream_nanoseconds_ + elapsed_nanoseconds(start));
+    auto block = Block::deserialize(std::string_view(decode_arena_.data(), size));
+    const Hash256 payload_digest(sha256(block.payload));
+    const auto computed_hash = compute_hash(block.header, payload_digest);
+    try {
+        accept_block(std::move(block), payload_digest, computed_hash, now);
+    } catch (...) {
+        sync_store();
+        throw;
+    }
+    sync_store();
+}
+
+void Blockchain::record_decode(const BlockCodec& codec,
+                               std::uint64_t bytes_in,
+                               std::uint64_t bytes_out,
+                               std::uint64_t nanoseconds) const {
+    auto& counters = telemetry_->at(codec.id());
+    counters.decoded_blocks.fetch_add(1, std::memory_order_relaxed);
+    counters.decode_bytes_in.fetch_add(bytes_in, std::memory_order_relaxed);
+    counters.decode_bytes_out.fetch_add(bytes_out, std::memory_order_relaxed);
+    counters.decode_nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+void Blockchain::accept_block(Block block) {
+    const Hash256 payload_digest(sha256(block.payload));
+    // Below an assume-valid checkpoint the header hash is checked later, in one batched pass.
+    const auto computed_hash =
+        assumed_valid(block.header.index) ? block.hash : compute_hash(block.header, payload_digest);
+    try {
+        accept_block(std::move(block), payload_digest, computed_hash, wall_clock_seconds());
+    } catch (...) {
+        sync_store();
+        throw;
+    }
+    sync_store();
+}
+
+void Blockchain::sync_store() {
+    if (store_) {
+        store_->sync();
+    }
+}
+
+void Blockchain::accept_block(Block block, const Hash256& payload_digest, const Hash256& computed_hash, std::uint64_t now) {
+    if (orphan_policy_.max_blocks != 0 && block.header.index > height() &&
+        !headers_.contains(block.header.previous_hash)) {
+        // Only the block's own integrity can be checked before its parent is known.
+        if (block.hash != computed_hash) {
+            throw std::runtime_error("hash mismatch");
+        }
+        add_orphan(std::move(block), payload_digest, now);
+        return;
+    }
+    link_block(std::move(block), payload_digest, computed_hash, now);
+    connect_orphans(now);
+}
 
-    if (block.header.index != chain_.size()) {
+void Blockchain::add_orphan(Block block, const Hash256& payload_digest, std::uint64_t now) {
+    expire_orphans(now);
+    const auto siblings = orphans_.equal_range(block.header.previous_hash);
+    for (auto it = siblings.first; it != siblings.second; ++it) {
+        if (it->second.block.hash == block.hash) {
+            return;
+        }
+    }
+
+    const auto parent = block.header.previous_hash;
+    const auto sequence = next_orphan_sequence_++;
+    orphan_statistics_.bytes += block.payload.size();
+    ++orphan_statistics_.blocks;
+    ++orphan_statistics_.added;
+    orphans_.emplace(parent, Orphan{std::move(block), payload_digest, now, sequence});
+    orphan_arrivals_.emplace(sequence, parent);
+    enforce_orphan_caps();
+}
+
+void Blockchain::connect_orphans(std::uint64_t now) {
+    while (!orphans_.empty()) {
+        const auto parent = headers_.hash(height() - 1);
+        auto children = orphans_.equal_range(parent);
+        if (children.first == children.second) {
+            return;
+        }
+        const auto oldest = std::min_element(children.first, children.second, [](const auto& a, const auto& b) {
+            return a.second.sequence < b.second.sequence;
+        });
+        auto orphan = take_orphan(oldest->second.sequence);
+        // The checkpoint block's failures (a hash mismatch, or a history the deferred pass rejects and the
+        // chain has already dropped) end the initial download; they are the caller's, not this orphan's.
+        const auto checkpoint = assume_valid_.has_value() && orphan.block.header.index == assume_valid_->height;
+        try {
+            const auto computed_hash = compute_hash(orphan.block.header, orphan.payload_digest);
+            link_block(std::move(orphan.block), orphan.payload_digest, computed_hash, now);
+        } catch (const std::runtime_error&) {
+            ++orphan_statistics_.rejected;
+            if (checkpoint) {
+                throw;
+            }
+            continue;
+        }
+        ++orphan_statistics_.connected;
+
+        // Siblings of the block just linked wait on a parent that is no longer the tip; they can never link.
+        while ((children = orphans_.equal_range(parent)).first != children.second) {
+            (void)take_orphan(children.first->second.sequence);
+            ++orphan_statistics_.rejected;
+        }
+    }
+}
+
+void Blockchain::expire_orphans(std::uint64_t now) {
+    while (!orphan_arrivals_.empty()) {
+        const auto oldest = orphan_arrivals_.begin();
+        const auto siblings = orphans_.equal_range(oldest->second);
+        const auto it = std::find_if(siblings.first, siblings.second, [&](const auto& entry) {
+            return entry.second.sequence == oldest->first;
+        });
+        if (it->second.received + orphan_policy_.expiry_seconds > now) {
+            return;
+        }
+        (void)take_orphan(oldest->first);
+        ++orphan_statistics_.expired;
+    }
+}
+
+void Blockchain::enforce_orphan_caps() {
+    while (orphan_statistics_.blocks > orphan_policy_.max_blocks || orphan_statistics_.bytes > orphan_policy_.max_bytes) {
+        (void)take_orphan(orphan_arrivals_.begin()->first);
+        ++orphan_statistics_.evicted;
+    }
+}
+
+Blockchain::Orphan Blockchain::take_orphan(std::uint64_t sequence) {
+    const auto arrival = orphan_arrivals_.find(sequence);
+    const auto siblings = orphans_.equal_range(arrival->second);
+    const auto it = std::find_if(siblings.first, siblings.second, [&](const auto& entry) {
+        return entry.second.sequence == sequence;
+    });
+    auto orphan = std::move(it->second);
+    orphans_.erase(it);
+    orphan_arrivals_.erase(arrival);
+    orphan_statistics_.bytes -= orphan.block.payload.size();
+    --orphan_statistics_.blocks;
+    return orphan;
+}
+
+void Blockchain::set_orphan_policy(const OrphanPolicy& policy) {
+    if (policy.max_blocks != 0 && policy.expiry_seconds == 0) {
+        throw std::runtime_error("orphan expiry must be > 0");
+    }
+    orphan_policy_ = policy;
+    enforce_orphan_caps();
+}
+
+OrphanStatistics Blockchain::orphan_statistics() const {
+    return orphan_statistics_;
+}
+
+void Blockchain::link_block(Block block, const Hash256& payload_digest, const Hash256& computed_hash, std::uint64_t now) {
+    if (block.header.index != height()) {
         throw std::runtime_error("index mismatch");
     }
-    if (block.header.previous_hash != chain_.back().hash) {
+    if (block.header.previous_hash != headers_.hash(height() - 1)) {
         throw std::runtime_error("previous hash mismatch");
     }
-    if (block.header.timestamp < chain_.back().header.timestamp) {
-        throw std::runtime_error("timestamp regression");
+    const auto assumed = assumed_valid(block.header.index);
+    if (!assumed) {
+        if (block.header.timestamp < headers_.timestamp(height() - 1)) {
+            throw std::runtime_error("timestamp regression");
+        }
+        if (block.header.timestamp > now + max_future_drift_seconds_) {
+            throw std::runtime_error("timestamp too far in the future");
+        }
+        if (block.hash != computed_hash) {
+            throw std::runtime_error("hash mismatch");
+        }
+    } else if (block.header.index == assume_valid_->height && block.hash != assume_valid_->hash) {
+        throw std::runtime_error("assume-valid checkpoint mismatch");
+    }
+
+    // The store is written first so that a failed write leaves memory and disk agreeing.
+    if (store_) {
+        store_->append(block, payload_digest);
+    }
+    headers_.append(block.header, block.hash, payload_digest);
+    resident_.push_back(std::move(block));
+    if (!assumed && validated_height_ == height() - 1) {
+        set_validated_height(height());
     }
-    if (block.header.timestamp > now + max_future_drift_seconds_) {
-        throw std::runtime_error("timestamp too far in the future");
+    if (store_ && resident_.size() > 2 * kResidentBlocks) {
+        const auto evicted = resident_.size() - kResidentBlocks;
+        resident_.erase(resident_.begin(), resident_.begin() + static_cast<std::ptrdiff_t>(evicted));
+        resident_base_ += evicted;
     }
-    if (block.hash != compute_hash(block.header, block.payload)) {
-        throw std::runtime_error("hash mismatch");
+
+    if (assumed && height() - 1 == assume_valid_->height) {
+        const auto report = finish_initial_download();
+        if (!report.valid) {
+            throw std::runtime_error("assume-valid history invalid at block " +
+                                     std::to_string(report.failed_block_index) + ": " + report.failure_reason);
+        }
     }
+}
 
-    chain_.push_back(block);
+void Blockchain::begin_initial_download(const AssumeValidCheckpoint& checkpoint) {
+    if (checkpoint.height < height()) {
+        throw std::runtime_error("assume-valid checkpoint below the tip");
+    }
+    if (validated_height_ != height()) {
+        throw std::runtime_error("initial download needs a validated chain");
+    }
+    assume_valid_ = checkpoint;
+}
+
+ValidationReport Blockchain::finish_initial_download() {
+    assume_valid_.reset();
+    // Blocks linked in the mode never moved the watermark, so it still marks where the mode began.
+    const auto first = std::min(validated_height_, height());
+    auto report = validate_from(first, ValidationMode::Headers);
+    if (!report.valid) {
+        truncate(first);
+    }
+    return report;
+}
+
+void Blockchain::truncate(std::size_t new_height) {
+    // The store goes first, as in link_block, so that a failed write leaves memory and disk agreeing.
+    if (store_) {
+        store_->truncate(new_height);
+    }
+    headers_.truncate(new_height);
+    if (new_height >= resident_base_) {
+        resident_.erase(resident_.begin() + static_cast<std::ptrdiff_t>(new_height - resident_base_), resident_.end());
+    } else {
+        resident_base_ = new_height - std::min(new_height, kResidentBlocks);
+        resident_ = store_->read_range(resident_base_, new_height);
+    }
+    validated_height_ = std::min(validated_height_, new_height);
 }
 
 bool Blockchain::is_valid() const {
     return validate_with_metrics().valid;
 }
 
-ValidationReport Blockchain::validate_with_metrics() const {
+ValidationReport Blockchain::validate_with_metrics(ValidationMode mode) const {
+    return validate_from(mode == ValidationMode::Incremental ? std::min(validated_height_, height()) : 0, mode);
+}
+
+ValidationReport Blockchain::validate_from(std::size_t first, ValidationMode mode) const {
     const auto start = std::chrono::steady_clock::now();
 
     ValidationReport report;
-    report.blocks_checked = chain_.size();
+    report.mode = mode;
+    report.first_block_checked = first;
+    report.blocks_checked = height() - report.first_block_checked;
 
-    if (chain_.empty()) {
+    if (height() == 0) {
         report.failure_reason = "empty chain";
-    } else if (chain_.front().header.index != 0 || chain_.front().header.previous_hash != "GENESIS") {
-        report.failure_reason = "invalid genesis header";
-    } else if (compute_hash(chain_.front().header, chain_.front().payload) != chain_.front().hash) {
-        report.failure_reason = "invalid genesis hash";
     } else {
-        report.valid = true;
-        const auto now = static_cast<std::uint64_t>(
-            std::chrono::duration_cast<std::chrono::seconds>(
-                std::chrono::system_clock::now().time_since_epoch())
-                .count());
-
-        for (std::size_t i = 1; i < chain_.size(); ++i) {
-            const auto& previous = chain_[i - 1];
-            const auto& current = chain_[i];
-            if (current.header.index != i) {
-                report.valid = false;
-                report.failed_block_index = i;
-                report.failure_reason = "index mismatch";
-                break;
-            }
-            if (current.header.timestamp < previous.header.timestamp) {
-                report.valid = false;
-                report.failed_block_index = i;
-                report.failure_reason = "timestamp regression";
-                break;
-            }
-            if (current.header.timestamp > now + max_future_drift_seconds_) {
-                report.valid = false;
-                report.failed_block_index = i;
-                report.failure_reason = "timestamp too far in the future";
-                break;
-            }
-            if (current.header.previous_hash != previous.hash) {
-                report.valid = false;
-                report.failed_block_index = i;
-                report.failure_reason = "previous hash mismatch";
-                break;
-            }
-            if (compute_hash(current.header, current.payload) != current.hash) {
-                report.valid = false;
-                report.failed_block_index = i;
-                report.failure_reason = "hash mismatch";
-                break;
-            }
-        }
+        check_blocks(report.first_block_checked, mode != ValidationMode::Headers, report);
     }
+    set_validated_height(report.valid ? height() : std::min(validated_height_, report.failed_block_index));
 
     const auto end = std::chrono::steady_clock::now();
     report.elapsed_microseconds = static_cast<std::uint64_t>(
@@ -160,4 +790,152 @@ ValidationReport Blockchain::validate_with_metrics() const {
     return report;
 }
 
+void Blockchain::set_validated_height(std::size_t height) const {
+    validated_height_ = height;
+    if (store_) {
+        store_->set_validated_height(height);
+    }
+}
+
+void Blockchain::set_validation_threads(std::size_t threads) {
+    validation_pool_ = threads > 1 ? std::make_unique<ThreadPool>(threads) : nullptr;
+}
+
+const char* Blockchain::check_link(std::size_t i, const Hash256& computed_hash, std::uint64_t now) const {
+    const auto timestamp = headers_.timestamp(i);
+    if (timestamp < headers_.timestamp(i - 1)) {
+        return "timestamp regression";
+    }
+    if (timestamp > now + max_future_drift_seconds_) {
+        return "timestamp too far in the future";
+    }
+    if (headers_.previous_hash(i) != headers_.hash(i - 1)) {
+        return "previous hash mismatch";
+    }
+    if (computed_hash != headers_.hash(i)) {
+        return "hash mismatch";
+    }
+    return nullptr;
+}
+
+const char* Blockchain::check_range(std::size_t begin,
+                                    std::size_t end,
+                                    std::uint64_t now,
+                                    bool with_payloads,
+                                    std::size_t& failed_at) const {
+    const auto hashes = headers_.compute_hashes(begin, end);
+
+    // Resident bodies are checked in place; older ones are paged in from the store one chunk at a time.
+    std::vector<Block> paged;
+    const Block* blocks = nullptr;
+    std::vector<Digest256> payload_digests;
+    if (with_payloads) {
+        if (begin >= resident_base_) {
+            blocks = resident_.data() + (begin - resident_base_);
+        } else {
+            try {
+                paged = store_->read_range(begin, end);
+            } catch (const std::runtime_error&) {
+                failed_at = begin;
+                return "block body unreadable";
+            }
+            blocks = paged.data();
+        }
+        std::vector<std::string_view> payloads;
+        payloads.reserve(end - begin);
+        for (std::size_t i = 0; i < end - begin; ++i) {
+            payloads.emplace_back(blocks[i].payload);
+        }
+        payload_digests.resize(end - begin);
+        sha256_batch(payloads.data(), payloads.size(), payload_digests.data());
+    }
+
+    for (auto i = begin; i < end; ++i) {
+        const char* failure = i == 0 ? nullptr : check_link(i, hashes[i - begin], now);
+        if (failure == nullptr && i == 0 && hashes[0] != headers_.hash(0)) {
+            failure = "invalid genesis hash";
+        }
+        if (failure == nullptr && with_payloads) {
+            const auto& body = blocks[i - begin];
+            if (body.header.index != i) {
+                failure = "index mismatch";
+            } else if (body.hash != headers_.hash(i) || Hash256(payload_digests[i - begin]) != headers_.payload_digest(i)) {
+                failure = i == 0 ? "invalid genesis hash" : "hash mismatch";
+            }
+        }
+        if (failure != nullptr) {
+            failed_at = i;
+            return failure;
+        }
+    }
+    return nullptr;
+}
+
+void Blockchain::check_blocks(std::size_t first, bool with_payloads, ValidationReport& report) const {
+    if (first == 0 && !headers_.previous_hash(0).is_zero()) {
+        report.failure_reason = "invalid genesis header";
+        return;
+    }
+    if (validation_pool_ && height() - first >= 2 * kValidationChunk) {
+        check_blocks_parallel(first, with_payloads, report);
+        return;
+    }
+
+    report.valid = true;
+    const auto now = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count());
+    for (auto begin = first; begin < height(); begin += kValidationChunk) {
+        const auto end = std::min(begin + kValidationChunk, height());
+        if (const auto* failure = check_range(begin, end, now, with_payloads, report.failed_block_index)) {
+            report.valid = false;
+            report.failure_reason = failure;
+            break;
+        }
+    }
+}
+
+void Blockchain::check_blocks_parallel(std::size_t first, bool with_payloads, ValidationReport& report) const {
+    const auto now = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count());
+    const auto chunks = (height() - first + kValidationChunk - 1) / kValidationChunk;
+
+    // Chunks above an already-found failure can stop early: only the lowest failing index is reported.
+    std::atomic<std::size_t> lowest_failure{height()};
+    std::vector<const char*> failures(chunks, nullptr);
+    std::vector<std::size_t> failed_at(chunks, 0);
+    std::vector<std::uint64_t> busy(validation_pool_->size(), 0);
+
+    validation_pool_->parallel_for(chunks, [&](std::size_t chunk, std::size_t worker) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto begin = first + chunk * kValidationChunk;
+        const auto end = std::min(begin + kValidationChunk, height());
+        if (begin < lowest_failure.load(std::memory_order_relaxed)) {
+            failures[chunk] = check_range(begin, end, now, with_payloads, failed_at[chunk]);
+            if (failures[chunk] != nullptr) {
+                const auto i = failed_at[chunk];
+                auto current = lowest_failure.load(std::memory_order_relaxed);
+                while (i < current && !lowest_failure.compare_exchange_weak(current, i, std::memory_order_relaxed)) {
+                }
+            }
+        }
+        busy[worker] += static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    });
+
+    report.valid = true;
+    report.thread_microseconds = std::move(busy);
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+        if (failures[chunk] != nullptr) {
+            report.valid = false;
+            report.failed_block_index = failed_at[chunk];
+            report.failure_reason = failures[chunk];
+            break;
+        }
+    }
+}
+
 }  // namespace elit21
@@ -1,88 +1,199 @@
 #include "elit21/codec.hpp"
 
-#include <algorithm>
+#include "elit21/dictionary.hpp"
+
+#include <array>
+#include <cstring>
 #include <stdexcept>
+#include <utility>
 
 namespace elit21 {
 
-std::vector<std::string> supported_codecs() {
-    return {"RLE", "RAW"};
+namespace {
+
+class RawCodec final : public BlockCodec {
+  public:
+    [[nodiscard]] CodecId id() const override { return CodecId::Raw; }
+    [[nodiscard]] std::string_view name() const override { return "RAW"; }
+
+    void compress(std::string_view raw_block, std::string& out) const override { out.assign(raw_block); }
+
+    [[nodiscard]] std::string decompress(std::string_view bytes, std::size_t max_output_bytes) const override {
+        if (bytes.size() > max_output_bytes) {
+            throw std::runtime_error("decompressed payload exceeds configured limit");
+        }
+        return std::string(bytes);
+    }
+
+    void decode_chunk(DecodeState& state, std::string_view chunk) const override {
+        if (chunk.size() > state.capacity - state.produced) {
+            throw std::runtime_error("decompressed payload exceeds configured limit");
+        }
+        std::memcpy(state.output + state.produced, chunk.data(), chunk.size());
+        state.produced += chunk.size();
+    }
+
+    void decode_finish(const DecodeState&) const override {}
+};
+
+struct CodecRegistry {
+    std::array<const BlockCodec*, 256> by_id{};
+    std::vector<const BlockCodec*> ordered;
+    std::vector<std::unique_ptr<BlockCodec>> plugged;
+
+    void add(const BlockCodec& codec) {
+        auto& slot = by_id[static_cast<std::size_t>(codec.id())];
+        if (slot != nullptr) {
+            throw std::runtime_error("codec id already registered");
+        }
+        for (const auto* existing : ordered) {
+            if (existing->name() == codec.name()) {
+                throw std::runtime_error("codec name already registered");
+            }
+        }
+        slot = &codec;
+        ordered.push_back(&codec);
+    }
+};
+
+CodecRegistry& codec_registry() {
+    static CodecRegistry registry = [] {
+        CodecRegistry built_in;
+        built_in.add(rle_codec());
+        built_in.add(raw_codec());
+        built_in.add(lz_codec());
+        return built_in;
+    }();
+    return registry;
 }
 
-bool is_supported_codec(const std::string& codec) {
-    const auto codecs = supported_codecs();
-    return std::find(codecs.begin(), codecs.end(), codec) != codecs.end();
+}  // namespace
+
+void BlockCodec::decode_chunk(DecodeState&, std::string_view) const {
+    throw std::runtime_error("codec does not support streaming decode");
 }
 
-CompressedBlock compress_block(const std::string& raw_block, const std::string& codec) {
-    if (!is_supported_codec(codec)) {
-        throw std::runtime_error("unsupported codec");
-    }
+void BlockCodec::decode_finish(const DecodeState&) const {
+    throw std::runtime_error("codec does not support streaming decode");
+}
 
-    CompressedBlock out;
-    out.codec = codec;
+void StreamDecompressor::reset(const BlockCodec& codec, char* output, std::size_t capacity) {
+    codec_ = &codec;
+    state_ = DecodeState{};
+    state_.output = output;
+    state_.capacity = capacity;
+}
 
-    if (codec == "RAW") {
-        out.bytes = raw_block;
-        return out;
+void StreamDecompressor::feed(std::string_view chunk) {
+    if (codec_ == nullptr) {
+        throw std::runtime_error("stream decompressor not started");
+    }
+    if (!chunk.empty()) {
+        codec_->decode_chunk(state_, chunk);
     }
+}
 
-    if (raw_block.empty()) {
-        return out;
+std::size_t StreamDecompressor::finish() {
+    if (codec_ == nullptr) {
+        throw std::runtime_error("stream decompressor not started");
     }
+    codec_->decode_finish(state_);
+    codec_ = nullptr;
+    return state_.produced;
+}
 
-    out.bytes.reserve(raw_block.size());
-    char current = raw_block.front();
-    std::uint8_t run = 1;
+const BlockCodec& raw_codec() {
+    static const RawCodec codec;
+    return codec;
+}
 
-    for (std::size_t i = 1; i < raw_block.size(); ++i) {
-        if (raw_block[i] == current && run < 255) {
-            ++run;
-        } else {
-            out.bytes.push_back(static_cast<char>(run));
-            out.bytes.push_back(current);
-            current = raw_block[i];
-            run = 1;
-        }
+void register_codec(std::unique_ptr<BlockCodec> codec) {
+    if (!codec) {
+        throw std::runtime_error("cannot register null codec");
     }
+    auto& registry = codec_registry();
+    registry.add(*codec);
+    registry.plugged.push_back(std::move(codec));
+}
 
-    out.bytes.push_back(static_cast<char>(run));
-    out.bytes.push_back(current);
-    return out;
+const BlockCodec* find_codec(CodecId id) {
+    return codec_registry().by_id[static_cast<std::size_t>(id)];
 }
 
-std::string decompress_block(const CompressedBlock& compressed, std::size_t max_output_bytes) {
-    if (compressed.version != 1) {
-        throw std::runtime_error("unsupported compressed block version");
+const BlockCodec* find_codec(std::string_view name) {
+    for (const auto* codec : codec_registry().ordered) {
+        if (codec->name() == name) {
+            return codec;
+        }
     }
-    if (!is_supported_codec(compressed.codec)) {
-        throw std::runtime_error("unsupported codec");
+    return nullptr;
+}
+
+std::optional<CodecId> codec_id(std::string_view name) {
+    if (const auto* codec = find_codec(name)) {
+        return codec->id();
     }
+    if (name == kDictionaryCodecName) {
+        return CodecId::LzDictionary;
+    }
+    return std::nullopt;
+}
 
-    if (compressed.codec == "RAW") {
-        if (compressed.bytes.size() > max_output_bytes) {
-            throw std::runtime_error("decompressed payload exceeds configured limit");
+std::vector<CodecId> codec_ids(const std::vector<std::string>& names) {
+    std::vector<CodecId> ids;
+    ids.reserve(names.size());
+    for (const auto& name : names) {
+        if (const auto id = codec_id(name)) {
+            ids.push_back(*id);
         }
-        return compressed.bytes;
     }
+    return ids;
+}
 
-    if (compressed.bytes.size() % 2 != 0) {
-        throw std::runtime_error("corrupted compressed bytes");
+std::vector<CodecId> supported_codec_ids() {
+    std::vector<CodecId> ids;
+    for (const auto* codec : codec_registry().ordered) {
+        ids.push_back(codec->id());
     }
+    return ids;
+}
 
-    std::string raw;
-    for (std::size_t i = 0; i < compressed.bytes.size(); i += 2) {
-        const auto count = static_cast<unsigned char>(compressed.bytes[i]);
-        if (count == 0) {
-            throw std::runtime_error("invalid run-length 0");
-        }
-        const char value = compressed.bytes[i + 1];
-        if (raw.size() + count > max_output_bytes) {
-            throw std::runtime_error("decompressed payload exceeds configured limit");
-        }
-        raw.append(count, value);
+std::vector<std::string> supported_codecs() {
+    std::vector<std::string> names;
+    for (const auto* codec : codec_registry().ordered) {
+        names.emplace_back(codec->name());
+    }
+    return names;
+}
+
+bool is_supported_codec(const std::string& codec) {
+    return find_codec(codec) != nullptr;
+}
+
+CompressedBlock compress_block(const std::string& raw_block, const std::string& codec) {
+    const auto* selected = find_codec(codec);
+    if (selected == nullptr) {
+        throw std::runtime_error("unsupported codec");
+    }
+    return compress_block(raw_block, *selected);
+}
+
+CompressedBlock compress_block(const std::string& raw_block, const BlockCodec& codec) {
+    CompressedBlock out;
+    out.codec = codec.id();
+    codec.compress(raw_block, out.bytes);
+    return out;
+}
+
+std::string decompress_block(const CompressedBlock& compressed, std::size_t max_output_bytes) {
+    if (compressed.version != 1) {
+        throw std::runtime_error("unsupported compressed block version");
+    }
+    const auto* codec = find_codec(compressed.codec);
+    if (codec == nullptr) {
+        throw std::runtime_error("unsupported codec");
     }
-    return raw;
+    return codec->decompress(compressed.bytes, max_output_bytes);
 }
 
 }  // namespace elit21
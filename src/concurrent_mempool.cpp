@@ -0,0 +1,251 @@
+#include "elit21/concurrent_mempool.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace elit21 {
+
+ConcurrentMempool::ConcurrentMempool(std::size_t max_transactions, std::size_t shards) {
+    if (max_transactions == 0) {
+        throw std::runtime_error("invalid mempool capacity");
+    }
+    if (shards == 0) {
+        throw std::runtime_error("mempool needs at least one shard");
+    }
+    max_per_shard_ = (max_transactions + shards - 1) / shards;
+    shards_.reserve(shards);
+    sender_shards_.reserve(shards);
+    for (std::size_t i = 0; i < shards; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+        sender_shards_.push_back(std::make_unique<SenderShard>());
+    }
+}
+
+ConcurrentMempool::Shard& ConcurrentMempool::shard_of(const Hash256& tx_id) const {
+    // The low bytes feed the hash tables inside the shard; pick the shard from other bits.
+    return *shards_[(std::hash<Hash256>{}(tx_id) >> 32) % shards_.size()];
+}
+
+ConcurrentMempool::SenderShard& ConcurrentMempool::sender_shard_of(const std::string& sender) const {
+    return *sender_shards_[std::hash<std::string>{}(sender) % sender_shards_.size()];
+}
+
+void ConcurrentMempool::add(const Transaction& tx) {
+    if (!is_valid_transaction(tx)) {
+        throw std::runtime_error("refusing invalid transaction");
+    }
+    const auto id = tx.id();
+    auto& target = shard_of(id);
+
+    // Lock order: a sender shard first, then at most one id shard at a time.
+    auto& senders = sender_shard_of(tx.from());
+    std::unique_lock<std::mutex> sender_lock(senders.mutex);
+    if (contains(id)) {
+        throw std::runtime_error("duplicate transaction");
+    }
+
+    // Slots are created only once the add succeeds, so a refused add leaves no empty sender behind.
+    const Hash256* slot_id = nullptr;
+    if (const auto sender = senders.by_sender.find(tx.from()); sender != senders.by_sender.end()) {
+        const auto slot = sender->second.find(tx.nonce());
+        slot_id = slot == sender->second.end() ? nullptr : &slot->second;
+    }
+    std::optional<Hash256> replaced;
+    std::optional<Transaction> evicted;
+    if (slot_id != nullptr) {
+        auto& holder = shard_of(*slot_id);
+        std::lock_guard<std::mutex> lock(holder.mutex);
+        const auto pending = holder.by_id.find(*slot_id);
+        if (pending != holder.by_id.end()) {
+            if (tx.fee() <= pending->second.tx.fee()) {
+                rejected_.fetch_add(1, std::memory_order_relaxed);
+                throw std::runtime_error("replacement fee too low");
+            }
+            replaced = *slot_id;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(target.mutex);
+        const auto frees_slot_here = replaced && &shard_of(*replaced) == &target;
+        if (!frees_slot_here && target.by_id.size() >= max_per_shard_) {
+            const auto cheapest = std::prev(target.by_priority.end());
+            if (tx.fee() <= cheapest->fee) {
+                rejected_.fetch_add(1, std::memory_order_relaxed);
+                throw std::runtime_error("mempool full");
+            }
+            evicted = target.by_id.at(Hash256(cheapest->id)).tx;
+            erase_locked(target, evicted->id());
+            evicted_.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (frees_slot_here) {
+            erase_locked(target, *replaced);
+        }
+        const auto sequence = next_sequence_.fetch_add(1, std::memory_order_relaxed);
+        target.by_id.emplace(id, Entry{tx, sequence});
+        target.by_priority.insert(MempoolPriority{tx.fee(), tx.nonce(), sequence, id});
+        size_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (replaced) {
+        auto& holder = shard_of(*replaced);
+        if (&holder != &target) {
+            std::lock_guard<std::mutex> lock(holder.mutex);
+            erase_locked(holder, *replaced);
+        }
+        replaced_.fetch_add(1, std::memory_order_relaxed);
+    }
+    senders.by_sender[tx.from()][tx.nonce()] = id;
+    sender_lock.unlock();
+
+    // The evicted sender's shard is locked only now, so that no thread ever holds two sender shards.
+    if (evicted) {
+        release_slot(*evicted);
+    }
+}
+
+void ConcurrentMempool::release_slot(const Transaction& evicted) {
+    auto& senders = sender_shard_of(evicted.from());
+    std::lock_guard<std::mutex> sender_lock(senders.mutex);
+    const auto sender = senders.by_sender.find(evicted.from());
+    if (sender == senders.by_sender.end()) {
+        return;
+    }
+    const auto slot = sender->second.find(evicted.nonce());
+    if (slot == sender->second.end() || slot->second != evicted.id() || contains(evicted.id())) {
+        return;
+    }
+    sender->second.erase(slot);
+    if (sender->second.empty()) {
+        senders.by_sender.erase(sender);
+    }
+}
+
+bool ConcurrentMempool::contains(const Hash256& tx_id) const {
+    const auto& shard = shard_of(tx_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.by_id.find(tx_id) != shard.by_id.end();
+}
+
+void ConcurrentMempool::remove_committed(const std::vector<Transaction>& committed) {
+    for (const auto& tx : committed) {
+        const auto id = tx.id();
+        auto& senders = sender_shard_of(tx.from());
+        std::lock_guard<std::mutex> sender_lock(senders.mutex);
+        {
+            auto& shard = shard_of(id);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            erase_locked(shard, id);
+        }
+        const auto sender = senders.by_sender.find(tx.from());
+        if (sender == senders.by_sender.end()) {
+            continue;
+        }
+        const auto slot = sender->second.find(tx.nonce());
+        if (slot != sender->second.end() && slot->second == id) {
+            sender->second.erase(slot);
+        }
+        if (sender->second.empty()) {
+            senders.by_sender.erase(sender);
+        }
+    }
+}
+
+std::size_t ConcurrentMempool::tracked_senders() const {
+    std::size_t count = 0;
+    for (const auto& senders : sender_shards_) {
+        std::lock_guard<std::mutex> lock(senders->mutex);
+        count += senders->by_sender.size();
+    }
+    return count;
+}
+
+MempoolStatistics ConcurrentMempool::statistics() const {
+    MempoolStatistics out;
+    out.replaced = replaced_.load(std::memory_order_relaxed);
+    out.evicted = evicted_.load(std::memory_order_relaxed);
+    out.rejected = rejected_.load(std::memory_order_relaxed);
+    return out;
+}
+
+std::vector<Transaction> ConcurrentMempool::snapshot() const {
+    return collect(max_per_shard_, size_.load(std::memory_order_relaxed) + max_per_shard_ * shards_.size());
+}
+
+std::vector<Transaction> ConcurrentMempool::select_for_block(std::size_t limit) const {
+    return pending_pool().select_for_block(limit);
+}
+
+std::vector<Transaction> ConcurrentMempool::select_for_block(std::size_t limit,
+                                                             const std::map<std::string, std::uint64_t>& balances) const {
+    return pending_pool().select_for_block(limit, balances);
+}
+
+Mempool ConcurrentMempool::pending_pool() const {
+    std::vector<Entry> pending;
+    {
+        const auto locks = lock_all();
+        pending.reserve(size_.load(std::memory_order_relaxed));
+        for (const auto& shard : shards_) {
+            for (const auto& [id, entry] : shard->by_id) {
+                pending.push_back(entry);
+            }
+        }
+    }
+    std::sort(pending.begin(), pending.end(), [](const Entry& a, const Entry& b) { return a.sequence < b.sequence; });
+
+    // A replacement briefly leaves both transactions of a nonce slot in the shards; replaying arrivals in
+    // order keeps the one that paid more, exactly as Mempool would have.
+    Mempool pool(std::max<std::size_t>(pending.size(), 1));
+    for (const auto& entry : pending) {
+        (void)pool.try_add(entry.tx);
+    }
+    return pool;
+}
+
+std::vector<std::unique_lock<std::mutex>> ConcurrentMempool::lock_all() const {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(shards_.size());
+    for (const auto& shard : shards_) {
+        locks.emplace_back(shard->mutex);
+    }
+    return locks;
+}
+
+void ConcurrentMempool::erase_locked(Shard& shard, const Hash256& tx_id) {
+    const auto it = shard.by_id.find(tx_id);
+    if (it == shard.by_id.end()) {
+        return;
+    }
+    shard.by_priority.erase(MempoolPriority{it->second.tx.fee(), it->second.tx.nonce(), it->second.sequence, tx_id});
+    shard.by_id.erase(it);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+std::vector<Transaction> ConcurrentMempool::collect(std::size_t per_shard_limit, std::size_t limit) const {
+    std::vector<std::pair<MempoolPriority, Transaction>> best;
+    {
+        const auto locks = lock_all();
+        for (const auto& shard : shards_) {
+            std::size_t taken = 0;
+            for (auto it = shard->by_priority.begin(); it != shard->by_priority.end() && taken < per_shard_limit; ++it, ++taken) {
+                best.emplace_back(*it, shard->by_id.at(it->id).tx);
+            }
+        }
+    }
+    std::sort(best.begin(), best.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    std::vector<Transaction> out;
+    out.reserve(std::min(limit, best.size()));
+    for (auto& entry : best) {
+        if (out.size() == limit) {
+            break;
+        }
+        out.push_back(std::move(entry.second));
+    }
+    return out;
+}
+
+}  // namespace elit21
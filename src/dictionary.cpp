@@ -0,0 +1,131 @@
+#include "elit21/dictionary.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace elit21 {
+
+namespace {
+
+constexpr std::size_t kGram = 8;
+constexpr std::size_t kSegment = 64;
+constexpr std::size_t kSegmentStep = 16;
+
+std::uint64_t read_gram(const char* p) {
+    std::uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+std::string content_id(const std::string& content) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (const char c : content) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    static constexpr char kHex[] = "0123456789abcdef";
+    std::string id(16, '0');
+    for (std::size_t i = 0; i < id.size(); ++i) {
+        id[id.size() - 1 - i] = kHex[(hash >> (4 * i)) & 0x0FU];
+    }
+    return id;
+}
+
+struct Candidate {
+    std::size_t sample;
+    std::size_t offset;
+    std::uint64_t score;
+};
+
+}  // namespace
+
+CompressionDictionary::CompressionDictionary(std::string content) : content_(std::move(content)) {
+    if (content_.size() < kMinBytes) {
+        throw std::runtime_error("compression dictionary too small");
+    }
+    if (content_.size() > kMaxBytes) {
+        throw std::runtime_error("compression dictionary too large");
+    }
+    id_ = content_id(content_);
+}
+
+CompressionDictionary CompressionDictionary::train(const std::vector<std::string>& samples, std::size_t max_bytes) {
+    max_bytes = std::min(max_bytes, kMaxBytes);
+    if (max_bytes < kSegment) {
+        throw std::runtime_error("dictionary budget too small");
+    }
+
+    std::unordered_map<std::uint64_t, std::uint32_t> frequency;
+    for (const auto& sample : samples) {
+        for (std::size_t i = 0; i + kGram <= sample.size(); ++i) {
+            ++frequency[read_gram(sample.data() + i)];
+        }
+    }
+
+    const auto segment_score = [&](const std::string& sample, std::size_t offset) {
+        std::uint64_t score = 0;
+        for (std::size_t i = offset; i + kGram <= offset + kSegment; ++i) {
+            const auto it = frequency.find(read_gram(sample.data() + i));
+            if (it != frequency.end() && it->second > 1) {
+                score += it->second;
+            }
+        }
+        return score;
+    };
+
+    std::vector<Candidate> candidates;
+    for (std::size_t s = 0; s < samples.size(); ++s) {
+        for (std::size_t offset = 0; offset + kSegment <= samples[s].size(); offset += kSegmentStep) {
+            const auto score = segment_score(samples[s], offset);
+            if (score > 0) {
+                candidates.push_back(Candidate{s, offset, score});
+            }
+        }
+    }
+    if (candidates.empty()) {
+        throw std::runtime_error("not enough repeated content to train a dictionary");
+    }
+
+    // Greedy cover: take the best segment, then discount the grams it already covers. Scores only ever
+    // drop, so a candidate whose refreshed score still beats the next one in line is the true best.
+    const auto by_score = [](const Candidate& a, const Candidate& b) { return a.score < b.score; };
+    std::make_heap(candidates.begin(), candidates.end(), by_score);
+    std::vector<Candidate> picked;
+    picked.reserve(max_bytes / kSegment);
+    std::size_t total = 0;
+    while (!candidates.empty() && total + kSegment <= max_bytes) {
+        std::pop_heap(candidates.begin(), candidates.end(), by_score);
+        auto best = candidates.back();
+        candidates.pop_back();
+
+        best.score = segment_score(samples[best.sample], best.offset);
+        if (best.score == 0) {
+            continue;
+        }
+        if (!candidates.empty() && best.score < candidates.front().score) {
+            candidates.push_back(best);
+            std::push_heap(candidates.begin(), candidates.end(), by_score);
+            continue;
+        }
+
+        const auto& sample = samples[best.sample];
+        for (std::size_t i = best.offset; i + kGram <= best.offset + kSegment; ++i) {
+            frequency.erase(read_gram(sample.data() + i));
+        }
+        picked.push_back(best);
+        total += kSegment;
+    }
+
+    std::string content;
+    content.reserve(total);
+    for (auto it = picked.rbegin(); it != picked.rend(); ++it) {
+        content.append(samples[it->sample], it->offset, kSegment);
+    }
+    return CompressionDictionary(std::move(content));
+}
+
+}  // namespace elit21
@@ -0,0 +1,53 @@
+#include "elit21/hash256.hpp"
+
+#include <stdexcept>
+
+namespace elit21 {
+
+namespace {
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+}  // namespace
+
+Hash256 Hash256::from_bytes(std::string_view bytes) {
+    if (bytes.size() != kSize) {
+        throw std::runtime_error("invalid hash length");
+    }
+    Digest256 digest;
+    std::memcpy(digest.data(), bytes.data(), kSize);
+    return Hash256(digest);
+}
+
+Hash256 Hash256::from_hex(std::string_view hex) {
+    if (hex.size() != 2 * kSize) {
+        throw std::runtime_error("invalid hash length");
+    }
+    Digest256 digest;
+    for (std::size_t i = 0; i < kSize; ++i) {
+        const auto high = hex_value(hex[2 * i]);
+        const auto low = hex_value(hex[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            throw std::runtime_error("invalid hash hex");
+        }
+        digest[i] = static_cast<std::uint8_t>((high << 4) | low);
+    }
+    return Hash256(digest);
+}
+
+std::string Hash256::to_hex() const {
+    return elit21::to_hex(bytes_);
+}
+
+}  // namespace elit21
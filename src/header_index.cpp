@@ -0,0 +1,134 @@
+#include "elit21/header_index.hpp"
+
+#include "elit21/sha256.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace elit21 {
+
+namespace {
+
+constexpr std::size_t kMinSlots = 64;
+
+}  // namespace
+
+void HeaderIndex::reserve(std::size_t count) {
+    timestamps_.reserve(count);
+    hashes_.reserve(count);
+    previous_hashes_.reserve(count);
+    payload_digests_.reserve(count);
+    if (2 * count > slots_.size()) {
+        auto capacity = std::max(slots_.size(), kMinSlots);
+        while (capacity < 2 * count) {
+            capacity *= 2;
+        }
+        rehash(capacity);
+    }
+}
+
+void HeaderIndex::append(const BlockHeader& header, const Hash256& hash, const Hash256& payload_digest) {
+    if (header.index != size()) {
+        throw std::runtime_error("header index out of sequence");
+    }
+    if (size() == std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("header index full");
+    }
+    timestamps_.push_back(header.timestamp);
+    hashes_.push_back(hash);
+    previous_hashes_.push_back(header.previous_hash);
+    payload_digests_.push_back(payload_digest);
+    if (2 * size() > slots_.size()) {
+        rehash(std::max(2 * slots_.size(), kMinSlots));
+    } else {
+        insert_slot(size() - 1);
+    }
+}
+
+void HeaderIndex::truncate(std::size_t height) {
+    if (height >= size()) {
+        return;
+    }
+    timestamps_.resize(height);
+    hashes_.resize(height);
+    previous_hashes_.resize(height);
+    payload_digests_.resize(height);
+    rehash(slots_.size());
+}
+
+BlockHeader HeaderIndex::header(std::size_t height) const {
+    BlockHeader out;
+    out.index = static_cast<std::uint32_t>(height);
+    out.timestamp = timestamps_.at(height);
+    out.previous_hash = previous_hashes_[height];
+    return out;
+}
+
+std::optional<std::size_t> HeaderIndex::find(const Hash256& hash) const {
+    if (slots_.empty()) {
+        return std::nullopt;
+    }
+    const auto mask = slots_.size() - 1;
+    for (auto slot = std::hash<Hash256>{}(hash) & mask;; slot = (slot + 1) & mask) {
+        const auto entry = slots_[slot];
+        if (entry == 0) {
+            return std::nullopt;
+        }
+        if (hashes_[entry - 1] == hash) {
+            return entry - 1;
+        }
+    }
+}
+
+std::vector<Hash256> HeaderIndex::compute_hashes(std::size_t first, std::size_t last) const {
+    if (first > last || last > size()) {
+        throw std::runtime_error("header range out of bounds");
+    }
+    const auto count = last - first;
+    std::string preimages;
+    preimages.reserve(count * kHeaderPreimageBytes);
+    for (auto height = first; height < last; ++height) {
+        append_header_preimage(preimages, header(height), payload_digests_[height]);
+    }
+    std::vector<std::string_view> messages(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        messages[i] = std::string_view(preimages).substr(i * kHeaderPreimageBytes, kHeaderPreimageBytes);
+    }
+    std::vector<Digest256> digests(count);
+    sha256_batch(messages.data(), count, digests.data());
+
+    std::vector<Hash256> out;
+    out.reserve(count);
+    for (const auto& digest : digests) {
+        out.emplace_back(digest);
+    }
+    return out;
+}
+
+void HeaderIndex::insert_slot(std::size_t height) {
+    const auto mask = slots_.size() - 1;
+    for (auto slot = std::hash<Hash256>{}(hashes_[height]) & mask;; slot = (slot + 1) & mask) {
+        const auto entry = slots_[slot];
+        if (entry == 0) {
+            slots_[slot] = static_cast<std::uint32_t>(height + 1);
+            return;
+        }
+        // A repeated hash keeps resolving to its lowest height.
+        if (hashes_[entry - 1] == hashes_[height]) {
+            return;
+        }
+    }
+}
+
+void HeaderIndex::rehash(std::size_t capacity) {
+    slots_.assign(capacity, 0);
+    for (std::size_t height = 0; height < size(); ++height) {
+        insert_slot(height);
+    }
+}
+
+}  // namespace elit21
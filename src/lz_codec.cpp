@@ -0,0 +1,441 @@
+#include "elit21/dictionary.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace elit21 {
+
+namespace {
+
+// LZ4-style block layout: a LEB128 decoded size, then sequences of
+//   token (literal length << 4 | (match length - 4)), literal length extension, literals,
+//   little-endian 16-bit offset, match length extension.
+// Nibble value 15 means "add the following bytes until one is below 255". The final sequence carries
+// literals only and ends the stream. "LZD" is the same layout with offsets allowed to reach back into a
+// shared dictionary that logically precedes the block.
+constexpr std::size_t kMinMatch = 4;
+constexpr std::size_t kMaxOffset = 65535;
+constexpr std::size_t kHashBits = 14;
+constexpr std::size_t kSkipTrigger = 6;
+
+std::uint32_t read32(const unsigned char* p) {
+    std::uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+std::size_t hash32(std::uint32_t value) {
+    return static_cast<std::size_t>((value * 2654435761U) >> (32 - kHashBits));
+}
+
+void put_length_extension(unsigned char*& out, std::size_t length) {
+    while (length >= 255) {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = static_cast<unsigned char>(length);
+}
+
+void put_sequence(unsigned char*& out, const unsigned char* literals, std::size_t literal_length,
+                  std::size_t offset, std::size_t match_length) {
+    const auto literal_nibble = literal_length < 15 ? literal_length : 15;
+    const auto match_code = match_length - kMinMatch;
+    const auto match_nibble = match_code < 15 ? match_code : 15;
+    *out++ = static_cast<unsigned char>((literal_nibble << 4) | match_nibble);
+    if (literal_nibble == 15) {
+        put_length_extension(out, literal_length - 15);
+    }
+    std::memcpy(out, literals, literal_length);
+    out += literal_length;
+    *out++ = static_cast<unsigned char>(offset & 0xFFU);
+    *out++ = static_cast<unsigned char>(offset >> 8);
+    if (match_nibble == 15) {
+        put_length_extension(out, match_code - 15);
+    }
+}
+
+void put_last_literals(unsigned char*& out, const unsigned char* literals, std::size_t literal_length) {
+    const auto literal_nibble = literal_length < 15 ? literal_length : 15;
+    *out++ = static_cast<unsigned char>(literal_nibble << 4);
+    if (literal_nibble == 15) {
+        put_length_extension(out, literal_length - 15);
+    }
+    std::memcpy(out, literals, literal_length);
+    out += literal_length;
+}
+
+std::size_t compress_bound(std::size_t size) {
+    return size + size / 255 + 16 + 10;
+}
+
+using HashTable = std::array<std::uint32_t, std::size_t{1} << kHashBits>;
+
+// Positions are numbered across dictionary + input, so a dictionary is simply history that precedes
+// the block: `primed` already maps the dictionary's 4-byte sequences to their positions.
+void lz_compress(std::string_view raw_block, std::string& out, std::string_view dictionary, const HashTable* primed) {
+    const auto* const begin = reinterpret_cast<const unsigned char*>(raw_block.data());
+    const auto size = raw_block.size();
+    const auto* const end = begin + size;
+    const auto* const dict = reinterpret_cast<const unsigned char*>(dictionary.data());
+    const auto dict_size = dictionary.size();
+    const auto at = [&](std::size_t position) {
+        return position < dict_size ? dict + position : begin + (position - dict_size);
+    };
+
+    out.resize(compress_bound(size));
+    auto* const out_begin = reinterpret_cast<unsigned char*>(out.data());
+    auto* cursor = out_begin;
+    for (auto remaining = size; ; remaining >>= 7U) {
+        if (remaining < 0x80U) {
+            *cursor++ = static_cast<unsigned char>(remaining);
+            break;
+        }
+        *cursor++ = static_cast<unsigned char>((remaining & 0x7FU) | 0x80U);
+    }
+
+    HashTable table;
+    if (primed != nullptr) {
+        table = *primed;
+    } else {
+        table.fill(0);
+    }
+    const auto* anchor = begin;
+    if (size > kMinMatch) {
+        const auto* const match_limit = end - kMinMatch;
+        const auto* ip = dict_size == 0 ? begin + 1 : begin;
+        std::size_t misses = 0;
+        while (ip <= match_limit) {
+            const auto sequence = read32(ip);
+            const auto position = dict_size + static_cast<std::size_t>(ip - begin);
+            auto& slot = table[hash32(sequence)];
+            std::size_t candidate = slot;
+            slot = static_cast<std::uint32_t>(position);
+
+            if (candidate >= position || position - candidate > kMaxOffset || read32(at(candidate)) != sequence) {
+                // Accelerate through incompressible stretches, as LZ4 does.
+                ip += 1 + (misses++ >> kSkipTrigger);
+                continue;
+            }
+            misses = 0;
+
+            auto match_start = ip;
+            while (match_start > anchor && candidate > 0 && match_start[-1] == *at(candidate - 1)) {
+                --match_start;
+                --candidate;
+            }
+            auto match_length = kMinMatch + static_cast<std::size_t>(ip - match_start);
+            if (candidate >= dict_size) {
+                const auto* source = begin + (candidate - dict_size);
+                while (match_start + match_length < end && match_start[match_length] == source[match_length]) {
+                    ++match_length;
+                }
+            } else {
+                while (match_start + match_length < end && match_start[match_length] == *at(candidate + match_length)) {
+                    ++match_length;
+                }
+            }
+
+            const auto match_position = dict_size + static_cast<std::size_t>(match_start - begin);
+            put_sequence(cursor, anchor, static_cast<std::size_t>(match_start - anchor), match_position - candidate,
+                         match_length);
+            ip = match_start + match_length;
+            anchor = ip;
+            if (ip - 2 >= begin && ip <= match_limit) {
+                table[hash32(read32(ip - 2))] = static_cast<std::uint32_t>(dict_size + static_cast<std::size_t>(ip - 2 - begin));
+            }
+        }
+    }
+    put_last_literals(cursor, anchor, static_cast<std::size_t>(end - anchor));
+    out.resize(static_cast<std::size_t>(cursor - out_begin));
+}
+
+[[noreturn]] void corrupted() {
+    throw std::runtime_error("corrupted compressed bytes");
+}
+
+std::size_t read_length_extension(const unsigned char*& in, const unsigned char* end, std::size_t length) {
+    for (;;) {
+        if (in == end) {
+            corrupted();
+        }
+        const auto byte = *in++;
+        length += byte;
+        if (byte != 255) {
+            return length;
+        }
+    }
+}
+
+// Copies a validated match. When the offset reaches back past the start of the output, the match begins in
+// the dictionary tail and continues into the output.
+void copy_match(unsigned char* out_begin, std::size_t produced, std::size_t offset, std::size_t match_length,
+                std::string_view dictionary) {
+    auto* out = out_begin + produced;
+    if (offset > produced) {
+        const auto back = offset - produced;
+        const auto from_dictionary = back < match_length ? back : match_length;
+        std::memcpy(out, dictionary.data() + (dictionary.size() - back), from_dictionary);
+        for (auto i = from_dictionary; i < match_length; ++i) {
+            out[i] = out_begin[i - back];
+        }
+        return;
+    }
+    const auto* match = out - offset;
+    if (offset >= match_length) {
+        std::memcpy(out, match, match_length);
+    } else {
+        for (std::size_t i = 0; i < match_length; ++i) {
+            out[i] = match[i];
+        }
+    }
+}
+
+std::string lz_decompress(std::string_view bytes, std::size_t max_output_bytes, std::string_view dictionary) {
+    const auto* in = reinterpret_cast<const unsigned char*>(bytes.data());
+    const auto* const end = in + bytes.size();
+
+    std::size_t decoded_size = 0;
+    for (unsigned shift = 0;; shift += 7) {
+        if (in == end || shift > 63) {
+            corrupted();
+        }
+        const auto byte = *in++;
+        decoded_size |= static_cast<std::size_t>(byte & 0x7FU) << shift;
+        if ((byte & 0x80U) == 0) {
+            break;
+        }
+    }
+    if (decoded_size > max_output_bytes) {
+        throw std::runtime_error("decompressed payload exceeds configured limit");
+    }
+
+    std::string raw(decoded_size, '\0');
+    auto* const out_begin = reinterpret_cast<unsigned char*>(raw.data());
+    auto* out = out_begin;
+    auto* const out_end = out_begin + decoded_size;
+
+    for (;;) {
+        if (in == end) {
+            corrupted();
+        }
+        const auto token = *in++;
+        std::size_t literal_length = token >> 4U;
+        if (literal_length == 15) {
+            literal_length = read_length_extension(in, end, literal_length);
+        }
+        if (literal_length > static_cast<std::size_t>(end - in) ||
+            literal_length > static_cast<std::size_t>(out_end - out)) {
+            corrupted();
+        }
+        std::memcpy(out, in, literal_length);
+        in += literal_length;
+        out += literal_length;
+
+        if (in == end) {
+            break;
+        }
+
+        if (end - in < 2) {
+            corrupted();
+        }
+        const auto offset = static_cast<std::size_t>(in[0]) | (static_cast<std::size_t>(in[1]) << 8U);
+        in += 2;
+        std::size_t match_length = token & 0x0FU;
+        if (match_length == 15) {
+            match_length = read_length_extension(in, end, match_length);
+        }
+        match_length += kMinMatch;
+        const auto produced = static_cast<std::size_t>(out - out_begin);
+        if (offset == 0 || offset > produced + dictionary.size() ||
+            match_length > static_cast<std::size_t>(out_end - out)) {
+            corrupted();
+        }
+        copy_match(out_begin, produced, offset, match_length, dictionary);
+        out += match_length;
+    }
+
+    if (out != out_end) {
+        corrupted();
+    }
+    return raw;
+}
+
+// Streaming decoder stages. scratch[0] holds the declared decoded size, scratch[1] the length being
+// accumulated (or literals left to copy), scratch[2] the current token and scratch[3] the match offset.
+enum LzStage : std::uint32_t {
+    kHeader = 0,
+    kToken,
+    kLiteralExtension,
+    kLiterals,
+    kOffsetLow,
+    kOffsetHigh,
+    kMatchExtension,
+};
+
+void copy_state_match(DecodeState& state, std::size_t offset, std::size_t match_length, std::string_view dictionary) {
+    if (offset == 0 || offset > state.produced + dictionary.size() || match_length > state.scratch[0] - state.produced) {
+        corrupted();
+    }
+    copy_match(reinterpret_cast<unsigned char*>(state.output), state.produced, offset, match_length, dictionary);
+    state.produced += match_length;
+}
+
+void lz_decode_chunk(DecodeState& state, std::string_view chunk, std::string_view dictionary) {
+    const auto* in = reinterpret_cast<const unsigned char*>(chunk.data());
+    const auto* const end = in + chunk.size();
+    auto& declared_size = state.scratch[0];
+    auto& length = state.scratch[1];
+    auto& token = state.scratch[2];
+    auto& offset = state.scratch[3];
+
+    while (in != end) {
+        switch (state.stage) {
+            case kHeader: {
+                const auto byte = *in++;
+                if (length > 63) {
+                    corrupted();
+                }
+                declared_size |= static_cast<std::uint64_t>(byte & 0x7FU) << length;
+                length += 7;
+                if ((byte & 0x80U) == 0) {
+                    if (declared_size > state.capacity) {
+                        throw std::runtime_error("decompressed payload exceeds configured limit");
+                    }
+                    state.stage = kToken;
+                }
+                break;
+            }
+            case kToken:
+                token = *in++;
+                length = token >> 4U;
+                state.stage = length == 15 ? kLiteralExtension : (length == 0 ? kOffsetLow : kLiterals);
+                break;
+            case kLiteralExtension: {
+                const auto byte = *in++;
+                length += byte;
+                if (byte != 255) {
+                    state.stage = kLiterals;
+                }
+                break;
+            }
+            case kLiterals: {
+                const auto available = static_cast<std::size_t>(end - in);
+                const auto take = length < available ? static_cast<std::size_t>(length) : available;
+                if (take > declared_size - state.produced) {
+                    corrupted();
+                }
+                std::memcpy(state.output + state.produced, in, take);
+                state.produced += take;
+                in += take;
+                length -= take;
+                if (length == 0) {
+                    state.stage = kOffsetLow;
+                }
+                break;
+            }
+            case kOffsetLow:
+                offset = *in++;
+                state.stage = kOffsetHigh;
+                break;
+            case kOffsetHigh:
+                offset |= static_cast<std::uint64_t>(*in++) << 8U;
+                length = token & 0x0FU;
+                if (length == 15) {
+                    state.stage = kMatchExtension;
+                } else {
+                    copy_state_match(state, static_cast<std::size_t>(offset), static_cast<std::size_t>(length) + kMinMatch, dictionary);
+                    state.stage = kToken;
+                }
+                break;
+            case kMatchExtension: {
+                const auto byte = *in++;
+                length += byte;
+                if (byte != 255) {
+                    copy_state_match(state, static_cast<std::size_t>(offset), static_cast<std::size_t>(length) + kMinMatch, dictionary);
+                    state.stage = kToken;
+                }
+                break;
+            }
+            default:
+                corrupted();
+        }
+    }
+}
+
+void lz_decode_finish(const DecodeState& state) {
+    if (state.stage != kOffsetLow || state.produced != state.scratch[0]) {
+        corrupted();
+    }
+}
+
+class LzCodec final : public BlockCodec {
+  public:
+    [[nodiscard]] CodecId id() const override { return CodecId::Lz; }
+    [[nodiscard]] std::string_view name() const override { return "LZ"; }
+
+    void compress(std::string_view raw_block, std::string& out) const override {
+        lz_compress(raw_block, out, {}, nullptr);
+    }
+
+    [[nodiscard]] std::string decompress(std::string_view bytes, std::size_t max_output_bytes) const override {
+        return lz_decompress(bytes, max_output_bytes, {});
+    }
+
+    void decode_chunk(DecodeState& state, std::string_view chunk) const override {
+        lz_decode_chunk(state, chunk, {});
+    }
+
+    void decode_finish(const DecodeState& state) const override { lz_decode_finish(state); }
+};
+
+class DictionaryLzCodec final : public BlockCodec {
+  public:
+    explicit DictionaryLzCodec(std::shared_ptr<const CompressionDictionary> dictionary)
+        : dictionary_(std::move(dictionary)) {
+        if (!dictionary_) {
+            throw std::runtime_error("dictionary codec requires a dictionary");
+        }
+        const auto& content = dictionary_->content();
+        primed_.fill(0);
+        for (std::size_t i = 0; i + kMinMatch <= content.size(); ++i) {
+            primed_[hash32(read32(reinterpret_cast<const unsigned char*>(content.data()) + i))] =
+                static_cast<std::uint32_t>(i);
+        }
+    }
+
+    [[nodiscard]] CodecId id() const override { return CodecId::LzDictionary; }
+    [[nodiscard]] std::string_view name() const override { return kDictionaryCodecName; }
+
+    void compress(std::string_view raw_block, std::string& out) const override {
+        lz_compress(raw_block, out, dictionary_->content(), &primed_);
+    }
+
+    [[nodiscard]] std::string decompress(std::string_view bytes, std::size_t max_output_bytes) const override {
+        return lz_decompress(bytes, max_output_bytes, dictionary_->content());
+    }
+
+    void decode_chunk(DecodeState& state, std::string_view chunk) const override {
+        lz_decode_chunk(state, chunk, dictionary_->content());
+    }
+
+    void decode_finish(const DecodeState& state) const override { lz_decode_finish(state); }
+
+  private:
+    std::shared_ptr<const CompressionDictionary> dictionary_;
+    HashTable primed_;
+};
+
+}  // namespace
+
+const BlockCodec& lz_codec() {
+    static const LzCodec codec;
+    return codec;
+}
+
+std::shared_ptr<const BlockCodec> make_dictionary_codec(std::shared_ptr<const CompressionDictionary> dictionary) {
+    return std::make_shared<DictionaryLzCodec>(std::move(dictionary));
+}
+
+}  // namespace elit21
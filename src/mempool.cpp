@@ -1,10 +1,47 @@
 #include "elit21/mempool.hpp"
 
 #include <algorithm>
+#include <iterator>
+#include <limits>
 #include <stdexcept>
 
 namespace elit21 {
 
+namespace {
+
+struct Product {
+    std::uint64_t high;
+    std::uint64_t low;
+};
+
+// Full 128-bit product, so fee-per-byte comparisons never round or overflow.
+Product multiply(std::uint64_t a, std::uint64_t b) {
+    const auto a_low = a & 0xffffffffU;
+    const auto a_high = a >> 32;
+    const auto b_low = b & 0xffffffffU;
+    const auto b_high = b >> 32;
+    const auto low_low = a_low * b_low;
+    const auto high_low = a_high * b_low;
+    const auto low_high = a_low * b_high;
+    const auto middle = (low_low >> 32) + (high_low & 0xffffffffU) + (low_high & 0xffffffffU);
+    return Product{a_high * b_high + (high_low >> 32) + (low_high >> 32) + (middle >> 32),
+                   (middle << 32) | (low_low & 0xffffffffU)};
+}
+
+}  // namespace
+
+bool Mempool::HigherFeeRate::operator()(const FeeRateKey& a, const FeeRateKey& b) const {
+    const auto left = multiply(a.fee, b.bytes);
+    const auto right = multiply(b.fee, a.bytes);
+    if (left.high != right.high) {
+        return left.high > right.high;
+    }
+    if (left.low != right.low) {
+        return left.low > right.low;
+    }
+    return a.sequence < b.sequence;
+}
+
 Mempool::Mempool(std::size_t max_transactions) : max_transactions_(max_transactions) {
     if (max_transactions_ == 0) {
         throw std::runtime_error("invalid mempool capacity");
@@ -12,51 +49,251 @@ Mempool::Mempool(std::size_t max_transactions) : max_transactions_(max_transacti
 }
 
 void Mempool::add(const Transaction& tx) {
-    if (!is_valid_transaction(tx)) {
+    switch (try_add(tx)) {
+    case MempoolAdmission::Added:
+        return;
+    case MempoolAdmission::Invalid:
         throw std::runtime_error("refusing invalid transaction");
-    }
-    if (contains(tx.id())) {
+    case MempoolAdmission::Duplicate:
         throw std::runtime_error("duplicate transaction");
-    }
-    if (transactions_.size() >= max_transactions_) {
+    case MempoolAdmission::ReplacementFeeTooLow:
+        throw std::runtime_error("replacement fee too low");
+    case MempoolAdmission::Full:
         throw std::runtime_error("mempool full");
     }
-    transactions_.push_back(tx);
 }
 
-bool Mempool::contains(const std::string& tx_id) const {
-    return std::any_of(transactions_.begin(), transactions_.end(), [&](const Transaction& tx) {
-        return tx.id() == tx_id;
-    });
+MempoolAdmission Mempool::try_add(const Transaction& tx) {
+    if (!is_valid_transaction(tx)) {
+        return MempoolAdmission::Invalid;
+    }
+    const auto id = tx.id();
+    if (contains(id)) {
+        return MempoolAdmission::Duplicate;
+    }
+
+    const Hash256* replaced = nullptr;
+    const auto sender = by_sender_.find(tx.from());
+    if (sender != by_sender_.end()) {
+        const auto same_nonce = sender->second.find(tx.nonce());
+        if (same_nonce != sender->second.end()) {
+            if (tx.fee() <= by_id_.at(same_nonce->second).tx.fee()) {
+                ++statistics_.rejected;
+                return MempoolAdmission::ReplacementFeeTooLow;
+            }
+            replaced = &same_nonce->second;
+        }
+    }
+    if (replaced != nullptr) {
+        erase(Hash256(*replaced));
+        ++statistics_.replaced;
+    } else if (by_id_.size() >= max_transactions_) {
+        // The last entry in priority order is the cheapest; it only goes if the newcomer pays strictly more.
+        const auto cheapest = std::prev(by_priority_.end());
+        if (tx.fee() <= cheapest->fee) {
+            ++statistics_.rejected;
+            return MempoolAdmission::Full;
+        }
+        erase(Hash256(cheapest->id));
+        ++statistics_.evicted;
+    }
+
+    const auto inserted = by_id_.emplace(id, Entry{tx, next_sequence_++, PayloadBuilder::encoded_size(tx)}).first;
+    by_priority_.insert(priority_of(id, inserted->second));
+    unindex_head(tx.from());
+    by_sender_[tx.from()][tx.nonce()] = id;
+    index_head(tx.from());
+    return MempoolAdmission::Added;
+}
+
+bool Mempool::contains(const Hash256& tx_id) const {
+    return by_id_.find(tx_id) != by_id_.end();
 }
 
 std::size_t Mempool::size() const {
-    return transactions_.size();
+    return by_id_.size();
 }
 
 std::vector<Transaction> Mempool::select_for_block(std::size_t limit) const {
-    auto selected = transactions_;
-    std::stable_sort(selected.begin(), selected.end(), [](const Transaction& a, const Transaction& b) {
-        if (a.fee != b.fee) {
-            return a.fee > b.fee;
+    return assemble(limit, nullptr);
+}
+
+std::vector<Transaction> Mempool::select_for_block(std::size_t limit,
+                                                   const std::map<std::string, std::uint64_t>& balances) const {
+    return assemble(limit, &balances);
+}
+
+std::vector<Transaction> Mempool::assemble(std::size_t limit,
+                                           const std::map<std::string, std::uint64_t>* balances) const {
+    using Queue = std::map<std::uint64_t, Hash256>;
+    // The next executable transaction of one sender, with what the sender can still spend.
+    struct Head {
+        MempoolPriority priority;
+        const Entry* entry;
+        Queue::const_iterator position;
+        Queue::const_iterator end;
+        std::uint64_t budget;
+    };
+    const auto worse = [](const Head& a, const Head& b) { return b.priority < a.priority; };
+    const auto cost_of = [](const Transaction& tx) { return tx.amount() + tx.fee(); };
+
+    std::vector<Head> heads;
+    heads.reserve(by_sender_.size());
+    const auto push = [&](Queue::const_iterator position, Queue::const_iterator end, std::uint64_t budget) {
+        const auto& entry = by_id_.at(position->second);
+        if (cost_of(entry.tx) > budget) {
+            return;
+        }
+        heads.push_back(Head{priority_of(position->second, entry), &entry, position, end, budget});
+        std::push_heap(heads.begin(), heads.end(), worse);
+    };
+
+    for (const auto& [sender, queue] : by_sender_) {
+        auto budget = std::numeric_limits<std::uint64_t>::max();
+        if (balances != nullptr) {
+            const auto balance = balances->find(sender);
+            if (balance == balances->end()) {
+                continue;
+            }
+            budget = balance->second;
+        }
+        push(queue.begin(), queue.end(), budget);
+    }
+
+    std::vector<Transaction> selected;
+    selected.reserve(std::min(limit, by_id_.size()));
+    while (!heads.empty() && selected.size() < limit) {
+        std::pop_heap(heads.begin(), heads.end(), worse);
+        const auto head = heads.back();
+        heads.pop_back();
+        selected.push_back(head.entry->tx);
+
+        const auto next = std::next(head.position);
+        if (next != head.end && next->first == head.position->first + 1) {
+            push(next, head.end, head.budget - cost_of(head.entry->tx));
         }
-        return a.nonce < b.nonce;
-    });
-    if (selected.size() > limit) {
-        selected.resize(limit);
     }
     return selected;
 }
 
+std::vector<Transaction> Mempool::block_template(std::size_t max_transactions,
+                                                 std::size_t max_bytes,
+                                                 const std::map<std::string, std::uint64_t>& balances) const {
+    std::vector<const Transaction*> chosen;
+    std::vector<TemplateCandidate> successors;
+    fill_template(max_transactions, max_bytes, balances, chosen, successors);
+    std::vector<Transaction> selected;
+    selected.reserve(chosen.size());
+    for (const auto* tx : chosen) {
+        selected.push_back(*tx);
+    }
+    return selected;
+}
+
+void Mempool::block_template(std::size_t max_transactions,
+                             std::size_t max_bytes,
+                             const std::map<std::string, std::uint64_t>& balances,
+                             std::vector<const Transaction*>& selected) {
+    fill_template(max_transactions, max_bytes, balances, selected, template_successors_);
+}
+
+void Mempool::fill_template(std::size_t max_transactions,
+                            std::size_t max_bytes,
+                            const std::map<std::string, std::uint64_t>& balances,
+                            std::vector<const Transaction*>& selected,
+                            std::vector<TemplateCandidate>& successors) const {
+    const HigherFeeRate higher;
+    const auto worse = [&higher](const TemplateCandidate& a, const TemplateCandidate& b) {
+        return higher(b.key, a.key);
+    };
+
+    successors.clear();
+    selected.clear();
+    auto remaining = max_bytes;
+    std::size_t misses = 0;
+    auto head = heads_by_fee_rate_.begin();
+    while (selected.size() < max_transactions && misses < kMaxTemplateMisses &&
+           (head != heads_by_fee_rate_.end() || !successors.empty())) {
+        TemplateCandidate next;
+        if (head != heads_by_fee_rate_.end() && (successors.empty() || higher(*head, successors.front().key))) {
+            const auto& from = by_id_.at(head->id).tx.from();
+            const auto balance = balances.find(from);
+            const auto& queue = by_sender_.at(from);
+            next = TemplateCandidate{*head, queue.begin(), queue.end(), 0};
+            ++head;
+            if (balance == balances.end()) {
+                continue;
+            }
+            next.budget = balance->second;
+        } else {
+            std::pop_heap(successors.begin(), successors.end(), worse);
+            next = successors.back();
+            successors.pop_back();
+        }
+
+        const auto& entry = by_id_.at(next.key.id);
+        const auto cost = entry.tx.amount() + entry.tx.fee();
+        if (cost > next.budget) {
+            continue;
+        }
+        if (entry.bytes > remaining) {
+            ++misses;
+            continue;
+        }
+        selected.push_back(&entry.tx);
+        remaining -= entry.bytes;
+        misses = 0;
+
+        const auto following = std::next(next.position);
+        if (following != next.end && following->first == next.position->first + 1) {
+            const auto key = fee_rate_of(following->second, by_id_.at(following->second));
+            successors.push_back(TemplateCandidate{key, following, next.end, next.budget - cost});
+            std::push_heap(successors.begin(), successors.end(), worse);
+        }
+    }
+}
+
 void Mempool::remove_committed(const std::vector<Transaction>& committed) {
     for (const auto& tx : committed) {
-        const auto tx_id = tx.id();
-        transactions_.erase(
-            std::remove_if(transactions_.begin(), transactions_.end(), [&](const Transaction& pending) {
-                return pending.id() == tx_id;
-            }),
-            transactions_.end());
+        erase(tx.id());
+    }
+}
+
+void Mempool::remove_committed(const std::vector<Hash256>& committed_ids) {
+    for (const auto& id : committed_ids) {
+        erase(id);
     }
 }
 
+void Mempool::erase(const Hash256& tx_id) {
+    const auto it = by_id_.find(tx_id);
+    if (it == by_id_.end()) {
+        return;
+    }
+    const auto& from = it->second.tx.from();
+    unindex_head(from);
+    const auto sender = by_sender_.find(from);
+    sender->second.erase(it->second.tx.nonce());
+    if (sender->second.empty()) {
+        by_sender_.erase(sender);
+    } else {
+        index_head(from);
+    }
+    by_priority_.erase(priority_of(tx_id, it->second));
+    by_id_.erase(it);
+}
+
+void Mempool::unindex_head(const std::string& sender) {
+    const auto queue = by_sender_.find(sender);
+    if (queue != by_sender_.end()) {
+        const auto& head = queue->second.begin()->second;
+        heads_by_fee_rate_.erase(fee_rate_of(head, by_id_.at(head)));
+    }
+}
+
+void Mempool::index_head(const std::string& sender) {
+    const auto& head = by_sender_.at(sender).begin()->second;
+    heads_by_fee_rate_.insert(fee_rate_of(head, by_id_.at(head)));
+}
+
 }  // namespace elit21
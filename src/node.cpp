@@ -1,6 +1,7 @@
 #include "elit21/node.hpp"
 
-#include <sstream>
+#include <algorithm>
+#include <charconv>
 #include <stdexcept>
 
 namespace elit21 {
@@ -31,76 +32,392 @@ const Wallet& Node::wallet(const std::string& address) const {
     return it->second;
 }
 
+const char* describe(SubmitStatus status) {
+    switch (status) {
+    case SubmitStatus::Accepted:
+        return "accepted";
+    case SubmitStatus::AlreadySeen:
+        return "transaction already seen";
+    case SubmitStatus::ProbablySeen:
+        return "transaction probably already seen";
+    case SubmitStatus::Invalid:
+        return "refusing invalid transaction";
+    case SubmitStatus::UnknownSender:
+        return "unknown sender";
+    case SubmitStatus::UnknownReceiver:
+        return "unknown receiver";
+    case SubmitStatus::InvalidSignature:
+        return "invalid signature";
+    case SubmitStatus::InsufficientBalance:
+        return "insufficient sender balance";
+    case SubmitStatus::Duplicate:
+        return "duplicate transaction";
+    case SubmitStatus::ReplacementFeeTooLow:
+        return "replacement fee too low";
+    case SubmitStatus::MempoolFull:
+        return "mempool full";
+    }
+    return "unknown submit status";
+}
+
 void Node::submit(const SignedTransaction& signed_tx) {
-    auto sender_it = wallets_.find(signed_tx.tx.from);
+    auto status = seen_status(signed_tx.tx.id());
+    if (status == SubmitStatus::Accepted) {
+        status = admit(signed_tx, check_submission(signed_tx));
+    }
+    if (status != SubmitStatus::Accepted) {
+        throw std::runtime_error(describe(status));
+    }
+}
+
+std::vector<SubmitStatus> Node::submit_batch(const std::vector<SignedTransaction>& batch) {
+    std::vector<SubmitStatus> statuses(batch.size(), SubmitStatus::Accepted);
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        statuses[i] = seen_status(batch[i].tx.id());
+    }
+    // Seen ones are settled; the rest still hold Accepted until checked.
+    std::vector<bool> unseen(batch.size());
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        unseen[i] = statuses[i] == SubmitStatus::Accepted;
+    }
+
+    const auto check_slice = [&](std::size_t slice, std::size_t) {
+        const auto end = std::min((slice + 1) * kSubmitSlice, batch.size());
+        for (auto i = slice * kSubmitSlice; i < end; ++i) {
+            if (unseen[i]) {
+                statuses[i] = check_submission(batch[i]);
+            }
+        }
+    };
+    const auto slices = (batch.size() + kSubmitSlice - 1) / kSubmitSlice;
+    if (submit_pool_) {
+        submit_pool_->parallel_for(slices, check_slice);
+    } else {
+        for (std::size_t slice = 0; slice < slices; ++slice) {
+            check_slice(slice, 0);
+        }
+    }
+
+    // Once admit has recorded an invalid transaction, a later copy of it in the batch is refused as seen, as it
+    // would be by a loop over submit.
+    bool recorded = false;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        if (!unseen[i]) {
+            continue;
+        }
+        if (recorded) {
+            if (const auto seen = seen_status(batch[i].tx.id()); seen != SubmitStatus::Accepted) {
+                statuses[i] = seen;
+                continue;
+            }
+        }
+        recorded = recorded || statuses[i] == SubmitStatus::Invalid;
+        statuses[i] = admit(batch[i], statuses[i]);
+    }
+    return statuses;
+}
+
+void Node::set_submit_threads(std::size_t threads) {
+    submit_pool_ = threads > 1 ? std::make_unique<ThreadPool>(threads) : nullptr;
+}
+
+SubmitStatus Node::check_submission(const SignedTransaction& signed_tx) const {
+    const auto& tx = signed_tx.tx;
+    if (!is_valid_transaction(tx)) {
+        return SubmitStatus::Invalid;
+    }
+    const auto sender_it = wallets_.find(tx.from());
     if (sender_it == wallets_.end()) {
-        throw std::runtime_error("unknown sender");
+        return SubmitStatus::UnknownSender;
     }
-    auto receiver_it = wallets_.find(signed_tx.tx.to);
-    if (receiver_it == wallets_.end()) {
-        throw std::runtime_error("unknown receiver");
+    if (wallets_.find(tx.to()) == wallets_.end()) {
+        return SubmitStatus::UnknownReceiver;
     }
     if (!sender_it->second.verify_signature(signed_tx)) {
-        throw std::runtime_error("invalid signature");
+        return SubmitStatus::InvalidSignature;
     }
-    if (!sender_it->second.can_afford(signed_tx.tx.amount, signed_tx.tx.fee)) {
-        throw std::runtime_error("insufficient sender balance");
+    if (!sender_it->second.can_afford(tx.amount(), tx.fee())) {
+        return SubmitStatus::InsufficientBalance;
     }
+    return SubmitStatus::Accepted;
+}
+
+SubmitStatus Node::seen_status(const Hash256& tx_id) {
+    switch (seen_.match(tx_id)) {
+    case SeenMatch::None:
+        return SubmitStatus::Accepted;
+    case SeenMatch::Exact:
+        return SubmitStatus::AlreadySeen;
+    case SeenMatch::Probable:
+        return SubmitStatus::ProbablySeen;
+    }
+    return SubmitStatus::AlreadySeen;
+}
 
-    mempool_.add(signed_tx.tx);
+SubmitStatus Node::admit(const SignedTransaction& signed_tx, SubmitStatus checked) {
+    if (checked == SubmitStatus::Invalid) {
+        seen_.insert(signed_tx.tx.id());
+    }
+    if (checked != SubmitStatus::Accepted) {
+        return checked;
+    }
+    switch (mempool_.try_add(signed_tx.tx)) {
+    case MempoolAdmission::Added:
+        return SubmitStatus::Accepted;
+    case MempoolAdmission::Invalid:
+        return SubmitStatus::Invalid;
+    case MempoolAdmission::Duplicate:
+        return SubmitStatus::Duplicate;
+    case MempoolAdmission::ReplacementFeeTooLow:
+        return SubmitStatus::ReplacementFeeTooLow;
+    case MempoolAdmission::Full:
+        return SubmitStatus::MempoolFull;
+    }
+    return SubmitStatus::Invalid;
 }
 
 std::size_t Node::mempool_size() const {
     return mempool_.size();
 }
 
+void Node::set_seen_filter_policy(const SeenFilterPolicy& policy) {
+    seen_ = SeenFilter(policy);
+}
+
 Block Node::forge_block_from_mempool(std::size_t max_transactions) {
-    const auto chosen = mempool_.select_for_block(max_transactions);
-    const auto payload = encode_transactions(chosen);
-    return blockchain_.create_block(payload);
+    // Wallets are never removed, so after the first forge this only overwrites existing entries.
+    for (const auto& [address, wallet] : wallets_) {
+        forge_balances_[address] = wallet.balance();
+    }
+    // The payload opens with the transaction count; the rest of the transport limit goes to transactions.
+    const auto framing = kMaxBlockFramingBytes + std::to_string(max_transactions).size() + 1;
+    const auto limit = blockchain_.max_transport_block_bytes();
+    mempool_.block_template(max_transactions, limit > framing ? limit - framing : 0, forge_balances_, forge_template_);
+    return blockchain_.create_block(payload_builder_.build(forge_template_));
 }
 
 void Node::commit_local_block(const Block& block) {
-    const auto txs = decode_transactions(block.payload);
+    require_tip_extension(block);
 
-    std::map<std::string, std::uint64_t> projected_balances;
-    for (const auto& [address, wallet] : wallets_) {
-        projected_balances.emplace(address, wallet.balance());
+    const auto txs = decode_transaction_views(block.payload);
+
+    // Projected balances in wallets_ order, so a binary search by view finds them without building a key.
+    struct Projected {
+        std::string_view address;
+        Wallet* wallet;
+        std::uint64_t balance;
+    };
+    std::vector<Projected> projected;
+    projected.reserve(wallets_.size());
+    for (auto& [address, wallet] : wallets_) {
+        projected.push_back(Projected{address, &wallet, wallet.balance()});
     }
+    const auto find = [&projected](std::string_view address) -> Projected* {
+        const auto it = std::lower_bound(projected.begin(), projected.end(), address,
+                                         [](const Projected& entry, std::string_view key) { return entry.address < key; });
+        return it != projected.end() && it->address == address ? &*it : nullptr;
+    };
 
     for (const auto& tx : txs) {
         if (!is_valid_transaction(tx)) {
             throw std::runtime_error("invalid transaction in block payload");
         }
 
-        auto sender_it = projected_balances.find(tx.from);
-        if (sender_it == projected_balances.end()) {
+        auto* sender = find(tx.from());
+        if (sender == nullptr) {
             throw std::runtime_error("unknown sender in block payload");
         }
-        auto receiver_it = projected_balances.find(tx.to);
-        if (receiver_it == projected_balances.end()) {
+        auto* receiver = find(tx.to());
+        if (receiver == nullptr) {
             throw std::runtime_error("unknown receiver in block payload");
         }
 
-        const auto total_cost = tx.amount + tx.fee;
-        if (sender_it->second < total_cost) {
+        const auto total_cost = tx.amount() + tx.fee();
+        if (sender->balance < total_cost) {
             throw std::runtime_error("insufficient sender balance in block payload");
         }
 
-        sender_it->second -= total_cost;
-        receiver_it->second += tx.amount;
+        sender->balance -= total_cost;
+        receiver->balance += tx.amount();
     }
 
-    const auto compressed = blockchain_.compress_for_transport(block, {"RLE", "RAW"});
+    const auto compressed = blockchain_.compress_for_codec_ids(block, supported_codec_ids());
     blockchain_.accept_from_network(compressed);
 
+    std::vector<Hash256> ids;
+    ids.reserve(txs.size());
     for (const auto& tx : txs) {
-        auto& sender = wallet(tx.from);
-        auto& receiver = wallet(tx.to);
-        sender.apply_debit(tx.amount, tx.fee);
-        receiver.apply_credit(tx.amount);
+        find(tx.from())->wallet->apply_debit(tx.amount(), tx.fee());
+        find(tx.to())->wallet->apply_credit(tx.amount());
+        ids.push_back(tx.id());
+    }
+    retire_committed(ids);
+}
+
+void Node::require_tip_extension(const Block& block) const {
+    // The chain would park a block with an unknown parent in the orphan pool and return normally, leaving the
+    // wallets ahead of the chain; a block whose wallet effects the node applies must link on the spot.
+    const auto& headers = blockchain_.headers();
+    if (block.header.index != headers.size() || block.header.previous_hash != headers.hash(headers.size() - 1)) {
+        throw std::runtime_error("block does not extend the local tip");
+    }
+}
+
+void Node::begin_initial_download(const AssumeValidCheckpoint& checkpoint) {
+    blockchain_.begin_initial_download(checkpoint);
+    download_ = InitialDownloadReport{};
+    download_start_ = std::chrono::steady_clock::now();
+    download_deltas_.clear();
+    download_committed_.clear();
+}
+
+void Node::replay_blocks(const std::vector<Block>& blocks) {
+    // Net effect of the blocks this call linked, applied when it returns or throws.
+    std::map<std::string, WalletDelta> deltas;
+    const auto apply_replayed = [&] {
+        apply_wallet_deltas(deltas);
+        for (const auto& [address, delta] : deltas) {
+            auto& total = download_deltas_[address];
+            total.credit += delta.credit;
+            total.debit += delta.debit;
+            total.fees += delta.fees;
+        }
+        deltas.clear();
+        if (!blockchain_.in_initial_download()) {
+            commit_download();
+        }
+    };
+
+    try {
+        for (const auto& block : blocks) {
+            if (!blockchain_.in_initial_download()) {
+                apply_replayed();
+                const auto transactions = decode_transaction_views(block.payload).size();
+                commit_local_block(block);
+                ++download_.blocks;
+                download_.transactions += transactions;
+                continue;
+            }
+
+            require_tip_extension(block);
+            const auto txs = decode_transactions(block.payload);
+            std::map<std::string, WalletDelta> block_deltas;
+            for (const auto& tx : txs) {
+                if (wallets_.find(tx.from()) == wallets_.end()) {
+                    throw std::runtime_error("unknown sender in block payload");
+                }
+                if (wallets_.find(tx.to()) == wallets_.end()) {
+                    throw std::runtime_error("unknown receiver in block payload");
+                }
+                auto& sender = block_deltas[tx.from()];
+                sender.debit += tx.amount();
+                sender.fees += tx.fee();
+                block_deltas[tx.to()].credit += tx.amount();
+            }
+            // Checked before linking, so that deltas always applies, even on the way out of a failure.
+            for (const auto& [address, delta] : block_deltas) {
+                auto credit = wallet(address).balance() + delta.credit;
+                auto spent = delta.debit + delta.fees;
+                if (const auto pending = deltas.find(address); pending != deltas.end()) {
+                    credit += pending->second.credit;
+                    spent += pending->second.debit + pending->second.fees;
+                }
+                if (credit < spent) {
+                    throw std::runtime_error("insufficient sender balance in replayed history");
+                }
+            }
+
+            try {
+                blockchain_.accept_block(block);
+            } catch (...) {
+                if (!blockchain_.in_initial_download()) {
+                    // The deferred header pass failed and the chain dropped everything linked since
+                    // begin_initial_download.
+                    deltas.clear();
+                    revert_download();
+                }
+                throw;
+            }
+            download_.checkpoint_reached = download_.checkpoint_reached || !blockchain_.in_initial_download();
+            ++download_.blocks;
+            download_.transactions += txs.size();
+            for (const auto& [address, delta] : block_deltas) {
+                auto& total = deltas[address];
+                total.credit += delta.credit;
+                total.debit += delta.debit;
+                total.fees += delta.fees;
+            }
+            const auto ids = transaction_ids(txs);
+            download_committed_.insert(download_committed_.end(), ids.begin(), ids.end());
+        }
+    } catch (...) {
+        // Blocks linked before the failure keep their wallet effects.
+        apply_replayed();
+        throw;
+    }
+    apply_replayed();
+}
+
+void Node::commit_download() {
+    download_deltas_.clear();
+    retire_committed(download_committed_);
+    download_committed_.clear();
+}
+
+void Node::revert_download() {
+    for (const auto& [address, delta] : download_deltas_) {
+        // Credit back first: the balance then holds at least what the history credited.
+        auto& target = wallet(address);
+        target.apply_credit(delta.debit + delta.fees);
+        target.apply_debit(delta.credit, 0);
+    }
+    download_deltas_.clear();
+    download_committed_.clear();
+}
+
+void Node::retire_committed(const std::vector<Hash256>& committed_ids) {
+    for (const auto& id : committed_ids) {
+        seen_.insert(id);
+    }
+    mempool_.remove_committed(committed_ids);
+}
+
+void Node::apply_wallet_deltas(const std::map<std::string, WalletDelta>& deltas) {
+    for (const auto& [address, delta] : deltas) {
+        if (wallet(address).balance() + delta.credit < delta.debit + delta.fees) {
+            throw std::runtime_error("insufficient sender balance in replayed history");
+        }
+    }
+    for (const auto& [address, delta] : deltas) {
+        auto& target = wallet(address);
+        target.apply_credit(delta.credit);
+        target.apply_debit(delta.debit, delta.fees);
     }
-    mempool_.remove_committed(txs);
+}
+
+InitialDownloadReport Node::initial_download_progress() const {
+    auto report = download_;
+    report.elapsed_microseconds = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - download_start_).count());
+    if (report.elapsed_microseconds != 0) {
+        const auto seconds = static_cast<double>(report.elapsed_microseconds) / 1e6;
+        report.blocks_per_second = static_cast<double>(report.blocks) / seconds;
+        report.transactions_per_second = static_cast<double>(report.transactions) / seconds;
+    }
+    return report;
+}
+
+InitialDownloadReport Node::finish_initial_download() {
+    if (blockchain_.in_initial_download()) {
+        const auto validation = blockchain_.finish_initial_download();
+        if (!validation.valid) {
+            revert_download();
+            throw std::runtime_error("assume-valid history invalid at block " +
+                                     std::to_string(validation.failed_block_index) + ": " + validation.failure_reason);
+        }
+        commit_download();
+    }
+    return initial_download_progress();
 }
 
 const Blockchain& Node::chain() const {
@@ -125,48 +442,59 @@ ReadinessReport Node::readiness_report(std::size_t min_wallets,
 }
 
 
-std::string Node::encode_transactions(const std::vector<Transaction>& txs) {
-    std::ostringstream os;
-    os << txs.size() << '\n';
-    for (const auto& tx : txs) {
-        const auto raw = tx.serialize();
-        os << raw.size() << '\n' << raw << '\n';
+std::vector<Transaction> Node::decode_transactions(const std::string& payload) {
+    const auto views = decode_transaction_views(payload);
+    std::vector<Transaction> txs;
+    txs.reserve(views.size());
+    for (const auto& view : views) {
+        txs.push_back(view.to_transaction());
     }
-    return os.str();
+    return txs;
 }
 
-std::vector<Transaction> Node::decode_transactions(const std::string& payload) {
-    std::istringstream is(payload);
-    std::size_t count = 0;
-    if (!(is >> count)) {
-        if (payload.empty()) {
-            return {};
+std::vector<TransactionView> Node::decode_transaction_views(std::string_view payload) {
+    if (payload.empty()) {
+        return {};
+    }
+    const auto* cursor = payload.data();
+    const auto* const end = payload.data() + payload.size();
+    // A decimal number closed by '\n'.
+    const auto read_number = [&](const char* error) {
+        std::size_t value = 0;
+        const auto [next, status] = std::from_chars(cursor, end, value);
+        if (status != std::errc() || next == end || *next != '\n') {
+            throw std::runtime_error(error);
         }
+        cursor = next + 1;
+        return value;
+    };
+
+    const auto count = read_number("invalid block payload transaction count");
+    // Every transaction takes at least its size line and delimiter, which bounds the reservation.
+    if (count > payload.size() / 3) {
         throw std::runtime_error("invalid block payload transaction count");
     }
-    is.get();
-
-    std::vector<Transaction> txs;
-    txs.reserve(count);
+    std::vector<TransactionView> views;
+    views.reserve(count);
     for (std::size_t i = 0; i < count; ++i) {
-        std::size_t size = 0;
-        if (!(is >> size)) {
-            throw std::runtime_error("invalid block payload transaction size");
-        }
-        is.get();
-
-        std::string raw(size, '\0');
-        is.read(raw.data(), static_cast<std::streamsize>(size));
-        if (is.gcount() != static_cast<std::streamsize>(size)) {
+        const auto size = read_number("invalid block payload transaction size");
+        if (static_cast<std::size_t>(end - cursor) < size) {
             throw std::runtime_error("invalid block payload transaction body");
         }
-        if (is.get() != '\n') {
+        const auto raw = std::string_view(cursor, size);
+        cursor += size;
+        if (cursor == end || *cursor != '\n') {
             throw std::runtime_error("invalid block payload delimiter");
         }
+        ++cursor;
 
-        txs.push_back(Transaction::deserialize(raw));
+        auto view = TransactionView::parse(raw);
+        if (!is_valid_transaction(view)) {
+            throw std::runtime_error("invalid transaction semantic");
+        }
+        views.push_back(view);
     }
-    return txs;
+    return views;
 }
 
 }  // namespace elit21
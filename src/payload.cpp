@@ -0,0 +1,69 @@
+#include "elit21/payload.hpp"
+
+#include <charconv>
+#include <limits>
+
+namespace elit21 {
+
+namespace {
+
+std::size_t decimal_digits(std::size_t value) {
+    std::size_t digits = 1;
+    while (value >= 10) {
+        value /= 10;
+        ++digits;
+    }
+    return digits;
+}
+
+}  // namespace
+
+std::size_t PayloadBuilder::encoded_size(const Transaction& tx) {
+    const auto serialized = tx.serialized_size();
+    return decimal_digits(serialized) + 1 + serialized + 1;
+}
+
+const std::string& PayloadBuilder::build(const std::vector<const Transaction*>& txs) {
+    std::size_t bytes = 0;
+    for (const auto* tx : txs) {
+        bytes += encoded_size(*tx);
+    }
+    begin(txs.size(), bytes);
+    for (const auto* tx : txs) {
+        append(*tx);
+    }
+    return buffer_;
+}
+
+const std::string& PayloadBuilder::build(const std::vector<Transaction>& txs) {
+    std::size_t bytes = 0;
+    for (const auto& tx : txs) {
+        bytes += encoded_size(tx);
+    }
+    begin(txs.size(), bytes);
+    for (const auto& tx : txs) {
+        append(tx);
+    }
+    return buffer_;
+}
+
+void PayloadBuilder::begin(std::size_t count, std::size_t bytes) {
+    buffer_.clear();
+    buffer_.reserve(decimal_digits(count) + 1 + bytes);
+    append_number(count);
+}
+
+void PayloadBuilder::append(const Transaction& tx) {
+    append_number(tx.serialized_size());
+    tx.serialize_to(buffer_);
+    buffer_.push_back('\n');
+}
+
+void PayloadBuilder::append_number(std::size_t value) {
+    char digits[std::numeric_limits<std::size_t>::digits10 + 1];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer_.append(digits, result.ptr);
+    buffer_.push_back('\n');
+}
+
+}  // namespace elit21
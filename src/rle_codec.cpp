@@ -0,0 +1,334 @@
+#include "elit21/codec.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define ELIT21_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace elit21 {
+
+namespace {
+
+constexpr std::size_t kMaxRun = 255;
+constexpr std::size_t kScanChunk = 4096;
+constexpr std::size_t kMaskWords = kScanChunk / 64;
+
+// Sets bit (i - begin) of `masks` when data[i] ends a run, i.e. differs from data[i + 1]; the last byte of the
+// input always ends a run. `begin` is a multiple of 64 and end - begin <= kScanChunk.
+using BoundaryScanner = void (*)(const unsigned char* data, std::size_t begin, std::size_t end, std::size_t size,
+                                 std::uint64_t* masks);
+// Returns the sum of the run-length bytes of an RLE stream, or 0 when a run-length is 0.
+using RunCounter = std::size_t (*)(const unsigned char* data, std::size_t size);
+
+struct RleKernels {
+    BoundaryScanner scan_boundaries;
+    RunCounter decoded_size;
+    const char* name;
+};
+
+void scan_boundaries_tail(const unsigned char* data, std::size_t from, std::size_t begin, std::size_t end,
+                          std::size_t size, std::uint64_t* masks) {
+    for (std::size_t i = from; i < end; ++i) {
+        if (i + 1 == size || data[i] != data[i + 1]) {
+            masks[(i - begin) / 64] |= std::uint64_t{1} << ((i - begin) % 64);
+        }
+    }
+}
+
+void scan_boundaries_scalar(const unsigned char* data, std::size_t begin, std::size_t end, std::size_t size,
+                            std::uint64_t* masks) {
+    std::fill(masks, masks + kMaskWords, std::uint64_t{0});
+    scan_boundaries_tail(data, begin, begin, end, size, masks);
+}
+
+std::size_t decoded_size_scalar(const unsigned char* data, std::size_t size) {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < size; i += 2) {
+        if (data[i] == 0) {
+            return 0;
+        }
+        total += data[i];
+    }
+    return total;
+}
+
+#if defined(ELIT21_X86_DISPATCH)
+
+__attribute__((target("sse2"))) void scan_boundaries_sse2(const unsigned char* data, std::size_t begin,
+                                                          std::size_t end, std::size_t size, std::uint64_t* masks) {
+    std::fill(masks, masks + kMaskWords, std::uint64_t{0});
+    std::size_t i = begin;
+    // Compare each 16-byte window with itself shifted by one byte: every mismatch is a run boundary.
+    for (; i + 16 < size && i + 16 <= end; i += 16) {
+        const __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+        const auto equal = static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(current, next)));
+        masks[(i - begin) / 64] |= (equal ^ 0xFFFFu) << ((i - begin) % 64);
+    }
+    scan_boundaries_tail(data, i, begin, end, size, masks);
+}
+
+__attribute__((target("avx2"))) void scan_boundaries_avx2(const unsigned char* data, std::size_t begin,
+                                                          std::size_t end, std::size_t size, std::uint64_t* masks) {
+    std::fill(masks, masks + kMaskWords, std::uint64_t{0});
+    std::size_t i = begin;
+    for (; i + 32 < size && i + 32 <= end; i += 32) {
+        const __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 1));
+        const auto equal =
+            static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(current, next)));
+        masks[(i - begin) / 64] |= static_cast<std::uint64_t>(~equal) << ((i - begin) % 64);
+    }
+    scan_boundaries_tail(data, i, begin, end, size, masks);
+}
+
+__attribute__((target("sse2"))) std::size_t decoded_size_sse2(const unsigned char* data, std::size_t size) {
+    // Run-length bytes sit at even offsets: mask the odd lanes away and let PSADBW do the horizontal sum.
+    const __m128i counts_mask = _mm_set1_epi16(0x00FF);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sums = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const __m128i chunk = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), counts_mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(chunk, zero)) != 0) {
+            return 0;
+        }
+        sums = _mm_add_epi64(sums, _mm_sad_epu8(chunk, zero));
+    }
+    auto total = static_cast<std::size_t>(_mm_cvtsi128_si64(sums)) +
+                 static_cast<std::size_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums)));
+    const auto tail = decoded_size_scalar(data + i, size - i);
+    if (i < size && tail == 0) {
+        return 0;
+    }
+    return total + tail;
+}
+
+__attribute__((target("avx2"))) std::size_t decoded_size_avx2(const unsigned char* data, std::size_t size) {
+    const __m256i counts_mask = _mm256_set1_epi16(0x00FF);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sums = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i chunk =
+            _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), counts_mask);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(chunk, zero)) != 0) {
+            return 0;
+        }
+        sums = _mm256_add_epi64(sums, _mm256_sad_epu8(chunk, zero));
+    }
+    const __m128i folded = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    auto total = static_cast<std::size_t>(_mm_cvtsi128_si64(folded)) +
+                 static_cast<std::size_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(folded, folded)));
+    const auto tail = decoded_size_scalar(data + i, size - i);
+    if (i < size && tail == 0) {
+        return 0;
+    }
+    return total + tail;
+}
+
+#endif
+
+RleKernels select_rle_kernels() {
+#if defined(ELIT21_X86_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {scan_boundaries_avx2, decoded_size_avx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return {scan_boundaries_sse2, decoded_size_sse2, "sse2"};
+    }
+#endif
+    return {scan_boundaries_scalar, decoded_size_scalar, "scalar"};
+}
+
+const RleKernels& rle_kernels() {
+    static const RleKernels kernels = select_rle_kernels();
+    return kernels;
+}
+
+std::size_t count_trailing_zeros(std::uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<std::size_t>(__builtin_ctzll(word));
+#else
+    std::size_t n = 0;
+    while ((word & 1U) == 0) {
+        word >>= 1U;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+std::size_t count_bits(std::uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<std::size_t>(__builtin_popcountll(word));
+#else
+    std::size_t n = 0;
+    for (; word != 0; word &= word - 1) {
+        ++n;
+    }
+    return n;
+#endif
+}
+
+std::size_t highest_bit(std::uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - static_cast<std::size_t>(__builtin_clzll(word));
+#else
+    std::size_t n = 0;
+    while (word >>= 1U) {
+        ++n;
+    }
+    return n;
+#endif
+}
+
+// Exact encoded size: one pair per run end plus one extra pair per 255 bytes of long runs. Only the first
+// boundary of a 64-byte word can close a run longer than 64 bytes, so the rest of the word is a popcount.
+std::size_t rle_encoded_size(const unsigned char* data, std::size_t size) {
+    const auto scan_boundaries = rle_kernels().scan_boundaries;
+    std::uint64_t masks[kMaskWords];
+    std::size_t pairs = 0;
+    std::size_t run_start = 0;
+    for (std::size_t begin = 0; begin < size; begin += kScanChunk) {
+        const auto end = std::min(size, begin + kScanChunk);
+        scan_boundaries(data, begin, end, size, masks);
+        for (std::size_t w = 0; w < kMaskWords; ++w) {
+            const auto word = masks[w];
+            if (word == 0) {
+                continue;
+            }
+            const auto base = begin + w * 64;
+            const auto first_end = base + count_trailing_zeros(word);
+            pairs += (first_end - run_start) / kMaxRun + count_bits(word);
+            run_start = base + highest_bit(word) + 1;
+        }
+    }
+    return pairs * 2;
+}
+
+void rle_encode(std::string_view raw_block, std::string& out) {
+    const auto* data = reinterpret_cast<const unsigned char*>(raw_block.data());
+    const auto size = raw_block.size();
+    const auto scan_boundaries = rle_kernels().scan_boundaries;
+
+    out.resize(rle_encoded_size(data, size));
+    auto* cursor = reinterpret_cast<unsigned char*>(out.data());
+    std::uint64_t masks[kMaskWords];
+    std::size_t run_start = 0;
+    for (std::size_t begin = 0; begin < size; begin += kScanChunk) {
+        const auto end = std::min(size, begin + kScanChunk);
+        scan_boundaries(data, begin, end, size, masks);
+        for (std::size_t w = 0; w < kMaskWords; ++w) {
+            const auto base = begin + w * 64;
+            for (auto word = masks[w]; word != 0; word &= word - 1) {
+                const auto run_end = base + count_trailing_zeros(word) + 1;
+                const auto value = data[run_start];
+                auto length = run_end - run_start;
+                while (length > kMaxRun) {
+                    *cursor++ = static_cast<unsigned char>(kMaxRun);
+                    *cursor++ = value;
+                    length -= kMaxRun;
+                }
+                *cursor++ = static_cast<unsigned char>(length);
+                *cursor++ = value;
+                run_start = run_end;
+            }
+        }
+    }
+}
+
+std::string rle_decode(std::string_view encoded, std::size_t max_output_bytes) {
+    if (encoded.size() % 2 != 0) {
+        throw std::runtime_error("corrupted compressed bytes");
+    }
+    if (encoded.empty()) {
+        return {};
+    }
+
+    const auto* data = reinterpret_cast<const unsigned char*>(encoded.data());
+    const auto total = rle_kernels().decoded_size(data, encoded.size());
+    if (total == 0) {
+        throw std::runtime_error("invalid run-length 0");
+    }
+    if (total > max_output_bytes) {
+        throw std::runtime_error("decompressed payload exceeds configured limit");
+    }
+
+    std::string raw(total, '\0');
+    auto* cursor = reinterpret_cast<unsigned char*>(raw.data());
+    for (std::size_t i = 0; i < encoded.size(); i += 2) {
+        if (data[i] == 1) {
+            *cursor++ = data[i + 1];
+        } else {
+            std::memset(cursor, data[i + 1], data[i]);
+            cursor += data[i];
+        }
+    }
+    return raw;
+}
+
+class RleCodec final : public BlockCodec {
+  public:
+    [[nodiscard]] CodecId id() const override { return CodecId::Rle; }
+    [[nodiscard]] std::string_view name() const override { return "RLE"; }
+
+    void compress(std::string_view raw_block, std::string& out) const override { rle_encode(raw_block, out); }
+
+    [[nodiscard]] std::string decompress(std::string_view bytes, std::size_t max_output_bytes) const override {
+        return rle_decode(bytes, max_output_bytes);
+    }
+
+    // stage 1 means a run-length byte arrived at the end of the previous chunk and sits in scratch[0].
+    void decode_chunk(DecodeState& state, std::string_view chunk) const override {
+        const auto* in = reinterpret_cast<const unsigned char*>(chunk.data());
+        const auto* const end = in + chunk.size();
+        if (state.stage == 1) {
+            put_run(state, static_cast<std::size_t>(state.scratch[0]), *in++);
+            state.stage = 0;
+        }
+        for (; end - in >= 2; in += 2) {
+            put_run(state, in[0], in[1]);
+        }
+        if (in != end) {
+            state.scratch[0] = *in;
+            state.stage = 1;
+        }
+    }
+
+    void decode_finish(const DecodeState& state) const override {
+        if (state.stage != 0) {
+            throw std::runtime_error("corrupted compressed bytes");
+        }
+    }
+
+  private:
+    static void put_run(DecodeState& state, std::size_t count, unsigned char value) {
+        if (count == 0) {
+            throw std::runtime_error("invalid run-length 0");
+        }
+        if (count > state.capacity - state.produced) {
+            throw std::runtime_error("decompressed payload exceeds configured limit");
+        }
+        std::memset(state.output + state.produced, value, count);
+        state.produced += count;
+    }
+};
+
+}  // namespace
+
+const BlockCodec& rle_codec() {
+    static const RleCodec codec;
+    return codec;
+}
+
+std::string rle_backend() {
+    return rle_kernels().name;
+}
+
+}  // namespace elit21
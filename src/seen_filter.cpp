@@ -0,0 +1,145 @@
+#include "elit21/seen_filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace elit21 {
+
+namespace {
+
+constexpr std::size_t kMaxHashFunctions = 32;
+
+// Ids are SHA-256 digests, so two of their words already give independent, uniform probe sequences.
+void probe_seeds(const Hash256& tx_id, std::uint64_t& first, std::uint64_t& step) {
+    std::memcpy(&first, tx_id.data() + 8, sizeof(first));
+    std::memcpy(&step, tx_id.data() + 16, sizeof(step));
+    step |= 1U;
+}
+
+}  // namespace
+
+SeenFilter::SeenFilter(const SeenFilterPolicy& policy) : policy_(policy) {
+    if (policy_.expected_transactions == 0) {
+        return;
+    }
+    if (!(policy_.false_positive_rate > 0.0 && policy_.false_positive_rate < 1.0)) {
+        throw std::runtime_error("seen filter false-positive rate must be in (0, 1)");
+    }
+    const auto ln2 = std::log(2.0);
+    const auto per_generation_rate = policy_.false_positive_rate / 2;
+    const auto bits = std::ceil(-static_cast<double>(policy_.expected_transactions) * std::log(per_generation_rate) /
+                                (ln2 * ln2));
+    bits_ = (static_cast<std::size_t>(bits) + 63) / 64 * 64;
+    const auto bits_per_entry = static_cast<double>(bits_) / static_cast<double>(policy_.expected_transactions);
+    hash_functions_ =
+        std::clamp<std::size_t>(static_cast<std::size_t>(std::lround(bits_per_entry * ln2)), 1, kMaxHashFunctions);
+    current_.words.assign(bits_ / 64, 0);
+    previous_.words.assign(bits_ / 64, 0);
+}
+
+void SeenFilter::insert(const Hash256& tx_id) {
+    if (bits_ == 0) {
+        return;
+    }
+    if (current_.entries == policy_.expected_transactions) {
+        std::swap(previous_, current_);
+        std::fill(current_.words.begin(), current_.words.end(), 0);
+        current_.set_bits = 0;
+        current_.entries = 0;
+        ++statistics_.rotations;
+    }
+    set_bits(current_, tx_id);
+    ++current_.entries;
+    ++statistics_.inserted;
+
+    if (policy_.exact_window == 0 || !window_ids_.insert(tx_id).second) {
+        return;
+    }
+    window_.push_back(tx_id);
+    if (window_.size() > policy_.exact_window) {
+        window_ids_.erase(window_.front());
+        window_.pop_front();
+    }
+}
+
+SeenMatch SeenFilter::match(const Hash256& tx_id) {
+    if (bits_ == 0) {
+        return SeenMatch::None;
+    }
+    if (window_ids_.find(tx_id) != window_ids_.end()) {
+        ++statistics_.exact_hits;
+        return SeenMatch::Exact;
+    }
+    if (test_bits(current_, tx_id) || test_bits(previous_, tx_id)) {
+        ++statistics_.probable_hits;
+        return SeenMatch::Probable;
+    }
+    return SeenMatch::None;
+}
+
+void SeenFilter::clear() {
+    for (auto* generation : {&current_, &previous_}) {
+        std::fill(generation->words.begin(), generation->words.end(), 0);
+        generation->set_bits = 0;
+        generation->entries = 0;
+    }
+    window_.clear();
+    window_ids_.clear();
+}
+
+SeenFilterStatistics SeenFilter::statistics() const {
+    auto out = statistics_;
+    out.bits_per_generation = bits_;
+    out.hash_functions = hash_functions_;
+    out.configured_false_positive_rate = bits_ == 0 ? 0.0 : policy_.false_positive_rate;
+    // Both generations, plus the window's deque slot and hash-set node per id.
+    if (bits_ != 0) {
+        out.memory_bytes = 2 * bits_ / 8 + policy_.exact_window * (2 * sizeof(Hash256) + 2 * sizeof(void*));
+    }
+    out.estimated_false_positive_rate =
+        1.0 - (1.0 - fill_false_positive_rate(current_)) * (1.0 - fill_false_positive_rate(previous_));
+    return out;
+}
+
+void SeenFilter::set_bits(Generation& generation, const Hash256& tx_id) {
+    std::uint64_t probe = 0;
+    std::uint64_t step = 0;
+    probe_seeds(tx_id, probe, step);
+    for (std::size_t i = 0; i < hash_functions_; ++i, probe += step) {
+        const auto bit = probe % bits_;
+        auto& word = generation.words[bit / 64];
+        const auto mask = std::uint64_t{1} << (bit % 64);
+        if ((word & mask) == 0) {
+            word |= mask;
+            ++generation.set_bits;
+        }
+    }
+}
+
+bool SeenFilter::test_bits(const Generation& generation, const Hash256& tx_id) const {
+    if (generation.entries == 0) {
+        return false;
+    }
+    std::uint64_t probe = 0;
+    std::uint64_t step = 0;
+    probe_seeds(tx_id, probe, step);
+    for (std::size_t i = 0; i < hash_functions_; ++i, probe += step) {
+        const auto bit = probe % bits_;
+        if ((generation.words[bit / 64] & (std::uint64_t{1} << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double SeenFilter::fill_false_positive_rate(const Generation& generation) const {
+    if (bits_ == 0 || generation.entries == 0) {
+        return 0.0;
+    }
+    const auto fill = static_cast<double>(generation.set_bits) / static_cast<double>(bits_);
+    return std::pow(fill, static_cast<double>(hash_functions_));
+}
+
+}  // namespace elit21
@@ -0,0 +1,438 @@
+#include "elit21/sha256.hpp"
+
+#include "elit21/wire.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define ELIT21_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace elit21 {
+
+namespace {
+
+constexpr std::array<std::uint32_t, 8> kInitialState = {
+    0x6a09e667U, 0xbb67ae85U, 0x3c6ef372U, 0xa54ff53aU, 0x510e527fU, 0x9b05688cU, 0x1f83d9abU, 0x5be0cd19U,
+};
+
+alignas(16) constexpr std::uint32_t kRoundConstants[64] = {
+    0x428a2f98U, 0x71374491U, 0xb5c0fbcfU, 0xe9b5dba5U, 0x3956c25bU, 0x59f111f1U, 0x923f82a4U, 0xab1c5ed5U,
+    0xd807aa98U, 0x12835b01U, 0x243185beU, 0x550c7dc3U, 0x72be5d74U, 0x80deb1feU, 0x9bdc06a7U, 0xc19bf174U,
+    0xe49b69c1U, 0xefbe4786U, 0x0fc19dc6U, 0x240ca1ccU, 0x2de92c6fU, 0x4a7484aaU, 0x5cb0a9dcU, 0x76f988daU,
+    0x983e5152U, 0xa831c66dU, 0xb00327c8U, 0xbf597fc7U, 0xc6e00bf3U, 0xd5a79147U, 0x06ca6351U, 0x14292967U,
+    0x27b70a85U, 0x2e1b2138U, 0x4d2c6dfcU, 0x53380d13U, 0x650a7354U, 0x766a0abbU, 0x81c2c92eU, 0x92722c85U,
+    0xa2bfe8a1U, 0xa81a664bU, 0xc24b8b70U, 0xc76c51a3U, 0xd192e819U, 0xd6990624U, 0xf40e3585U, 0x106aa070U,
+    0x19a4c116U, 0x1e376c08U, 0x2748774cU, 0x34b0bcb5U, 0x391c0cb3U, 0x4ed8aa4aU, 0x5b9cca4fU, 0x682e6ff3U,
+    0x748f82eeU, 0x78a5636fU, 0x84c87814U, 0x8cc70208U, 0x90befffaU, 0xa4506cebU, 0xbef9a3f7U, 0xc67178f2U,
+};
+
+// Compresses `blocks` consecutive 64-byte blocks into `state`.
+using Compressor = void (*)(std::uint32_t* state, const unsigned char* data, std::size_t blocks);
+using BatchHasher = void (*)(const std::string_view* messages, std::size_t count, Digest256* digests);
+
+std::uint32_t load_be32(const unsigned char* p) {
+    return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16) |
+           (static_cast<std::uint32_t>(p[2]) << 8) | static_cast<std::uint32_t>(p[3]);
+}
+
+void store_be32(unsigned char* p, std::uint32_t value) {
+    p[0] = static_cast<unsigned char>(value >> 24);
+    p[1] = static_cast<unsigned char>(value >> 16);
+    p[2] = static_cast<unsigned char>(value >> 8);
+    p[3] = static_cast<unsigned char>(value);
+}
+
+Digest256 digest_from_state(const std::uint32_t* state) {
+    Digest256 digest;
+    for (std::size_t i = 0; i < 8; ++i) {
+        store_be32(digest.data() + 4 * i, state[i]);
+    }
+    return digest;
+}
+
+// Writes the padding of a message whose trailing `tail_size` (< 64) bytes are `tail` into `out`; returns the
+// number of padding blocks (1 or 2).
+std::size_t pad_tail(const unsigned char* tail, std::size_t tail_size, std::uint64_t total_bytes, unsigned char* out) {
+    const std::size_t blocks = tail_size < 56 ? 1 : 2;
+    std::memset(out, 0, 64 * blocks);
+    if (tail_size != 0) {
+        std::memcpy(out, tail, tail_size);
+    }
+    out[tail_size] = 0x80U;
+    const auto bits = total_bytes * 8;
+    for (std::size_t i = 0; i < 8; ++i) {
+        out[64 * blocks - 1 - i] = static_cast<unsigned char>(bits >> (8 * i));
+    }
+    return blocks;
+}
+
+std::uint32_t rotr(std::uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+void compress_scalar(std::uint32_t* state, const unsigned char* data, std::size_t blocks) {
+    std::uint32_t w[64];
+    for (; blocks != 0; --blocks, data += 64) {
+        for (std::size_t t = 0; t < 16; ++t) {
+            w[t] = load_be32(data + 4 * t);
+        }
+        for (std::size_t t = 16; t < 64; ++t) {
+            const auto s0 = rotr(w[t - 15], 7) ^ rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+            const auto s1 = rotr(w[t - 2], 17) ^ rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+            w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+        }
+
+        auto a = state[0], b = state[1], c = state[2], d = state[3];
+        auto e = state[4], f = state[5], g = state[6], h = state[7];
+        for (std::size_t t = 0; t < 64; ++t) {
+            const auto t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + kRoundConstants[t] + w[t];
+            const auto t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+template <Compressor compress>
+void batch_serial(const std::string_view* messages, std::size_t count, Digest256* digests) {
+    unsigned char padding[128];
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto* data = reinterpret_cast<const unsigned char*>(messages[i].data());
+        const auto full = messages[i].size() / 64;
+        auto state = kInitialState;
+        compress(state.data(), data, full);
+        const auto blocks = pad_tail(data + 64 * full, messages[i].size() % 64, messages[i].size(), padding);
+        compress(state.data(), padding, blocks);
+        digests[i] = digest_from_state(state.data());
+    }
+}
+
+#if defined(ELIT21_X86_DISPATCH)
+
+// Keeps the state as ABEF/CDGH, the operand layout of SHA256RNDS2.
+__attribute__((target("sha,sse4.1"))) void compress_shani(std::uint32_t* state, const unsigned char* data,
+                                                           std::size_t blocks) {
+    const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (; blocks != 0; --blocks, data += 64) {
+        const __m128i abef = state0;
+        const __m128i cdgh = state1;
+        __m128i w[4];
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC unroll 16
+#endif
+        for (int group = 0; group < 16; ++group) {
+            __m128i& current = w[group & 3];
+            if (group < 4) {
+                current = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * group)), byte_swap);
+            } else {
+                const __m128i sigma0 = _mm_sha256msg1_epu32(current, w[(group + 1) & 3]);
+                const __m128i with_w7 = _mm_add_epi32(sigma0, _mm_alignr_epi8(w[(group + 3) & 3], w[(group + 2) & 3], 4));
+                current = _mm_sha256msg2_epu32(with_w7, w[(group + 3) & 3]);
+            }
+            __m128i message = _mm_add_epi32(
+                current, _mm_load_si128(reinterpret_cast<const __m128i*>(kRoundConstants + 4 * group)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+            message = _mm_shuffle_epi32(message, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, message);
+        }
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+}
+
+template <int N>
+__attribute__((target("avx2"))) inline __m256i rotr8(__m256i x) {
+    return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N));
+}
+
+constexpr std::size_t kLanes = 8;
+
+// Lane l of every vector belongs to message l. Each lane walks its own message blocks, then its padding blocks;
+// a lane that is done keeps hashing a dummy block and its state is captured when its last block completes.
+__attribute__((target("avx2"))) void batch_avx2(const std::string_view* messages, std::size_t count,
+                                                Digest256* digests) {
+    alignas(64) static const unsigned char dummy_block[64] = {};
+    alignas(64) unsigned char padding[kLanes][128];
+    alignas(32) std::uint32_t lanes[8][kLanes];
+
+    for (std::size_t first = 0; first < count; first += kLanes) {
+        const auto active = std::min(kLanes, count - first);
+        if (active == 1) {
+            batch_serial<compress_scalar>(messages + first, 1, digests + first);
+            continue;
+        }
+
+        const unsigned char* data[kLanes];
+        std::size_t full_blocks[kLanes];
+        std::size_t total_blocks[kLanes];
+        std::size_t rounds = 0;
+        for (std::size_t l = 0; l < kLanes; ++l) {
+            if (l >= active) {
+                data[l] = dummy_block;
+                full_blocks[l] = 0;
+                total_blocks[l] = 0;
+                continue;
+            }
+            const auto& message = messages[first + l];
+            data[l] = reinterpret_cast<const unsigned char*>(message.data());
+            full_blocks[l] = message.size() / 64;
+            total_blocks[l] = full_blocks[l] + pad_tail(data[l] + 64 * full_blocks[l], message.size() % 64,
+                                                        message.size(), padding[l]);
+            rounds = std::max(rounds, total_blocks[l]);
+        }
+
+        __m256i s[8];
+        for (std::size_t j = 0; j < 8; ++j) {
+            s[j] = _mm256_set1_epi32(static_cast<int>(kInitialState[j]));
+        }
+
+        for (std::size_t block = 0; block < rounds; ++block) {
+            const unsigned char* p[kLanes];
+            for (std::size_t l = 0; l < kLanes; ++l) {
+                if (block < full_blocks[l]) {
+                    p[l] = data[l] + 64 * block;
+                } else if (block < total_blocks[l]) {
+                    p[l] = padding[l] + 64 * (block - full_blocks[l]);
+                } else {
+                    p[l] = dummy_block;
+                }
+            }
+
+            __m256i w[16];
+            for (std::size_t t = 0; t < 16; ++t) {
+                w[t] = _mm256_setr_epi32(
+                    static_cast<int>(load_be32(p[0] + 4 * t)), static_cast<int>(load_be32(p[1] + 4 * t)),
+                    static_cast<int>(load_be32(p[2] + 4 * t)), static_cast<int>(load_be32(p[3] + 4 * t)),
+                    static_cast<int>(load_be32(p[4] + 4 * t)), static_cast<int>(load_be32(p[5] + 4 * t)),
+                    static_cast<int>(load_be32(p[6] + 4 * t)), static_cast<int>(load_be32(p[7] + 4 * t)));
+            }
+
+            __m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+            for (std::size_t t = 0; t < 64; ++t) {
+                if (t >= 16) {
+                    const auto w15 = w[(t - 15) & 15];
+                    const auto w2 = w[(t - 2) & 15];
+                    const auto s0 = _mm256_xor_si256(_mm256_xor_si256(rotr8<7>(w15), rotr8<18>(w15)),
+                                                     _mm256_srli_epi32(w15, 3));
+                    const auto s1 = _mm256_xor_si256(_mm256_xor_si256(rotr8<17>(w2), rotr8<19>(w2)),
+                                                     _mm256_srli_epi32(w2, 10));
+                    w[t & 15] = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], s0),
+                                                 _mm256_add_epi32(w[(t - 7) & 15], s1));
+                }
+                const auto big_s1 = _mm256_xor_si256(_mm256_xor_si256(rotr8<6>(e), rotr8<11>(e)), rotr8<25>(e));
+                const auto ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+                const auto t1 = _mm256_add_epi32(
+                    _mm256_add_epi32(_mm256_add_epi32(h, big_s1), _mm256_add_epi32(ch, w[t & 15])),
+                    _mm256_set1_epi32(static_cast<int>(kRoundConstants[t])));
+                const auto big_s0 = _mm256_xor_si256(_mm256_xor_si256(rotr8<2>(a), rotr8<13>(a)), rotr8<22>(a));
+                const auto maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+                h = g;
+                g = f;
+                f = e;
+                e = _mm256_add_epi32(d, t1);
+                d = c;
+                c = b;
+                b = a;
+                a = _mm256_add_epi32(t1, _mm256_add_epi32(big_s0, maj));
+            }
+            s[0] = _mm256_add_epi32(s[0], a);
+            s[1] = _mm256_add_epi32(s[1], b);
+            s[2] = _mm256_add_epi32(s[2], c);
+            s[3] = _mm256_add_epi32(s[3], d);
+            s[4] = _mm256_add_epi32(s[4], e);
+            s[5] = _mm256_add_epi32(s[5], f);
+            s[6] = _mm256_add_epi32(s[6], g);
+            s[7] = _mm256_add_epi32(s[7], h);
+
+            bool stored = false;
+            for (std::size_t l = 0; l < active; ++l) {
+                if (total_blocks[l] != block + 1) {
+                    continue;
+                }
+                if (!stored) {
+                    for (std::size_t j = 0; j < 8; ++j) {
+                        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[j]), s[j]);
+                    }
+                    stored = true;
+                }
+                std::uint32_t state[8];
+                for (std::size_t j = 0; j < 8; ++j) {
+                    state[j] = lanes[j][l];
+                }
+                digests[first + l] = digest_from_state(state);
+            }
+        }
+    }
+}
+
+#endif
+
+struct Sha256Kernels {
+    Compressor compress;
+    const char* name;
+    BatchHasher batch;
+    const char* batch_name;
+};
+
+Sha256Kernels select_sha256_kernels() {
+#if defined(ELIT21_X86_DISPATCH)
+    __builtin_cpu_init();
+    const bool has_sha = __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+    if (has_sha) {
+        return {compress_shani, "sha-ni", batch_serial<compress_shani>, "sha-ni"};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return {compress_scalar, "scalar", batch_avx2, "avx2x8"};
+    }
+#endif
+    return {compress_scalar, "scalar", batch_serial<compress_scalar>, "scalar"};
+}
+
+const Sha256Kernels& sha256_kernels() {
+    static const Sha256Kernels kernels = select_sha256_kernels();
+    return kernels;
+}
+
+}  // namespace
+
+Sha256::Sha256() : state_(kInitialState) {}
+
+Sha256& Sha256::update(const void* data, std::size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    total_bytes_ += size;
+    const auto compress = sha256_kernels().compress;
+    if (buffered_ != 0) {
+        const auto take = std::min(size, buffer_.size() - buffered_);
+        std::memcpy(buffer_.data() + buffered_, bytes, take);
+        buffered_ += take;
+        bytes += take;
+        size -= take;
+        if (buffered_ < buffer_.size()) {
+            return *this;
+        }
+        compress(state_.data(), buffer_.data(), 1);
+        buffered_ = 0;
+    }
+    const auto full = size / 64;
+    if (full != 0) {
+        compress(state_.data(), bytes, full);
+        bytes += 64 * full;
+        size -= 64 * full;
+    }
+    if (size != 0) {
+        std::memcpy(buffer_.data(), bytes, size);
+        buffered_ = size;
+    }
+    return *this;
+}
+
+Sha256& Sha256::update_u32(std::uint32_t value) {
+    unsigned char bytes[4];
+    for (std::size_t i = 0; i < 4; ++i) {
+        bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+    return update(bytes, sizeof(bytes));
+}
+
+Sha256& Sha256::update_u64(std::uint64_t value) {
+    unsigned char bytes[8];
+    for (std::size_t i = 0; i < 8; ++i) {
+        bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+    return update(bytes, sizeof(bytes));
+}
+
+Sha256& Sha256::update_sized(std::string_view bytes) {
+    std::string length;
+    wire::put_varint(length, bytes.size());
+    update(length);
+    return update(bytes);
+}
+
+Digest256 Sha256::finish() {
+    unsigned char padding[128];
+    const auto blocks = pad_tail(buffer_.data(), buffered_, total_bytes_, padding);
+    sha256_kernels().compress(state_.data(), padding, blocks);
+    const auto digest = digest_from_state(state_.data());
+    *this = Sha256();
+    return digest;
+}
+
+Digest256 sha256(std::string_view bytes) {
+    return Sha256().update(bytes).finish();
+}
+
+Digest256 hmac_sha256(std::string_view key, std::string_view message) {
+    std::array<unsigned char, 64> block{};
+    if (key.size() > block.size()) {
+        const auto hashed = sha256(key);
+        std::memcpy(block.data(), hashed.data(), hashed.size());
+    } else if (!key.empty()) {
+        std::memcpy(block.data(), key.data(), key.size());
+    }
+
+    std::array<unsigned char, 64> pad;
+    for (std::size_t i = 0; i < block.size(); ++i) {
+        pad[i] = static_cast<unsigned char>(block[i] ^ 0x36U);
+    }
+    const auto inner = Sha256().update(pad.data(), pad.size()).update(message).finish();
+    for (std::size_t i = 0; i < block.size(); ++i) {
+        pad[i] = static_cast<unsigned char>(block[i] ^ 0x5cU);
+    }
+    return Sha256().update(pad.data(), pad.size()).update(inner.data(), inner.size()).finish();
+}
+
+void sha256_batch(const std::string_view* messages, std::size_t count, Digest256* digests) {
+    sha256_kernels().batch(messages, count, digests);
+}
+
+std::string to_hex(const Digest256& digest) {
+    static constexpr char kHex[] = "0123456789abcdef";
+    std::string hex(2 * digest.size(), '0');
+    for (std::size_t i = 0; i < digest.size(); ++i) {
+        hex[2 * i] = kHex[digest[i] >> 4];
+        hex[2 * i + 1] = kHex[digest[i] & 0x0FU];
+    }
+    return hex;
+}
+
+std::string sha256_backend() {
+    return sha256_kernels().name;
+}
+
+std::string sha256_batch_backend() {
+    return sha256_kernels().batch_name;
+}
+
+}  // namespace elit21
@@ -0,0 +1,118 @@
+#include "elit21/thread_pool.hpp"
+
+#include <stdexcept>
+
+namespace elit21 {
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0) {
+        throw std::runtime_error("thread pool needs at least one thread");
+    }
+    queues_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    workers_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back([this, i] { run_worker(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallel_for(std::size_t count, const Task& task) {
+    if (count == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+
+    // Contiguous slices per worker keep neighbouring tasks on one thread until stealing kicks in.
+    const auto per_worker = (count + queues_.size() - 1) / queues_.size();
+    for (std::size_t w = 0; w < queues_.size(); ++w) {
+        std::lock_guard<std::mutex> lock(queues_[w]->mutex);
+        for (std::size_t i = w * per_worker; i < count && i < (w + 1) * per_worker; ++i) {
+            queues_[w]->tasks.push_back(i);
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_ = &task;
+    error_ = nullptr;
+    remaining_.store(count, std::memory_order_relaxed);
+    ++generation_;
+    wake_.notify_all();
+    done_.wait(lock, [&] { return remaining_.load(std::memory_order_acquire) == 0 && active_workers_ == 0; });
+    job_ = nullptr;
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void ThreadPool::run_worker(std::size_t worker) {
+    std::uint64_t seen = 0;
+    for (;;) {
+        const Task* job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+            job = job_;
+            ++active_workers_;
+        }
+
+        std::size_t task = 0;
+        while (job != nullptr && next_task(worker, task)) {
+            try {
+                (*job)(task, worker);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+            }
+            remaining_.fetch_sub(1, std::memory_order_acq_rel);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        --active_workers_;
+        if (active_workers_ == 0 && remaining_.load(std::memory_order_acquire) == 0) {
+            done_.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::next_task(std::size_t worker, std::size_t& task) {
+    {
+        auto& own = *queues_[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    for (std::size_t k = 1; k < queues_.size(); ++k) {
+        auto& victim = *queues_[(worker + k) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace elit21
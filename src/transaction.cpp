@@ -1,46 +1,204 @@
 #include "elit21/transaction.hpp"
 
-#include <functional>
+#include "elit21/sha256.hpp"
+#include "elit21/wire.hpp"
+
+#include <charconv>
 #include <sstream>
 #include <stdexcept>
+#include <utility>
 
 namespace elit21 {
 
-std::string Transaction::id() const {
-    const auto seed = from + "|" + to + "|" + std::to_string(amount) + "|" +
-                      std::to_string(fee) + "|" + std::to_string(nonce) + "|" + memo;
-    return std::to_string(std::hash<std::string>{}(seed));
+namespace {
+
+void append_id_preimage(std::string& out, const Transaction& tx) {
+    wire::put_bytes(out, tx.from());
+    wire::put_bytes(out, tx.to());
+    wire::put_u64(out, tx.amount());
+    wire::put_u64(out, tx.fee());
+    wire::put_u64(out, tx.nonce());
+    wire::put_bytes(out, tx.memo());
+}
+
+Hash256 hash_fields(std::string_view from,
+                    std::string_view to,
+                    std::uint64_t amount,
+                    std::uint64_t fee,
+                    std::uint64_t nonce,
+                    std::string_view memo) {
+    return Hash256(Sha256()
+                       .update_sized(from)
+                       .update_sized(to)
+                       .update_u64(amount)
+                       .update_u64(fee)
+                       .update_u64(nonce)
+                       .update_sized(memo)
+                       .finish());
+}
+
+bool valid_fields(std::string_view from, std::string_view to, std::uint64_t amount) {
+    return !from.empty() && !to.empty() && amount != 0 && from != to;
+}
+
+}  // namespace
+
+Transaction::Transaction(std::string from,
+                         std::string to,
+                         std::uint64_t amount,
+                         std::uint64_t fee,
+                         std::uint64_t nonce,
+                         std::string memo)
+    : from_(std::move(from)),
+      to_(std::move(to)),
+      amount_(amount),
+      fee_(fee),
+      nonce_(nonce),
+      memo_(std::move(memo)),
+      id_(compute_id()),
+      has_id_(true) {}
+
+void Transaction::set_from(std::string from) {
+    from_ = std::move(from);
+    has_id_ = false;
+}
+
+void Transaction::set_to(std::string to) {
+    to_ = std::move(to);
+    has_id_ = false;
+}
+
+void Transaction::set_amount(std::uint64_t amount) {
+    amount_ = amount;
+    has_id_ = false;
+}
+
+void Transaction::set_fee(std::uint64_t fee) {
+    fee_ = fee;
+    has_id_ = false;
+}
+
+void Transaction::set_nonce(std::uint64_t nonce) {
+    nonce_ = nonce;
+    has_id_ = false;
+}
+
+void Transaction::set_memo(std::string memo) {
+    memo_ = std::move(memo);
+    has_id_ = false;
+}
+
+const Hash256& Transaction::id() const {
+    if (!has_id_) {
+        id_ = compute_id();
+        has_id_ = true;
+    }
+    return id_;
+}
+
+Hash256 Transaction::compute_id() const {
+    return hash_fields(from_, to_, amount_, fee_, nonce_, memo_);
+}
+
+std::size_t Transaction::serialized_size() const {
+    return kTransactionMagic.size() + 1 + 3 * 8 +
+           wire::varint_size(from_.size()) + from_.size() +
+           wire::varint_size(to_.size()) + to_.size() +
+           wire::varint_size(memo_.size()) + memo_.size();
+}
+
+void Transaction::serialize_to(std::string& out) const {
+    out.append(kTransactionMagic);
+    wire::put_u8(out, kTransactionFormatVersion);
+    wire::put_bytes(out, from_);
+    wire::put_bytes(out, to_);
+    wire::put_u64(out, amount_);
+    wire::put_u64(out, fee_);
+    wire::put_u64(out, nonce_);
+    wire::put_bytes(out, memo_);
 }
 
 std::string Transaction::serialize() const {
+    std::string out;
+    out.reserve(serialized_size());
+    serialize_to(out);
+    return out;
+}
+
+std::string Transaction::serialize_text() const {
     std::ostringstream os;
-    os << from.size() << '|' << from
-       << '|' << to.size() << '|' << to
-       << '|' << amount
-       << '|' << fee
-       << '|' << nonce
-       << '|' << memo.size() << '|' << memo;
+    os << from_.size() << '|' << from_
+       << '|' << to_.size() << '|' << to_
+       << '|' << amount_
+       << '|' << fee_
+       << '|' << nonce_
+       << '|' << memo_.size() << '|' << memo_;
     return os.str();
 }
 
-Transaction Transaction::deserialize(const std::string& raw) {
+Transaction Transaction::deserialize(std::string_view raw) {
+    auto tx = TransactionView::parse(raw).to_transaction();
+    if (!is_valid_transaction(tx)) {
+        throw std::runtime_error("invalid transaction semantic");
+    }
+    return tx;
+}
+
+TransactionView TransactionView::parse(std::string_view raw) {
+    if (raw.substr(0, kTransactionMagic.size()) == kTransactionMagic) {
+        return parse_binary(raw);
+    }
+    return parse_text(raw);
+}
+
+Hash256 TransactionView::id() const {
+    return hash_fields(from_, to_, amount_, fee_, nonce_, memo_);
+}
+
+Transaction TransactionView::to_transaction() const {
+    return Transaction(std::string(from_), std::string(to_), amount_, fee_, nonce_, std::string(memo_));
+}
+
+TransactionView TransactionView::parse_binary(std::string_view raw) {
+    wire::Reader reader(raw.substr(kTransactionMagic.size()), "invalid transaction: ");
+    if (reader.u8("version") != kTransactionFormatVersion) {
+        reader.fail("version");
+    }
+    TransactionView view;
+    view.from_ = reader.bytes("from");
+    view.to_ = reader.bytes("to");
+    view.amount_ = reader.u64("amount");
+    view.fee_ = reader.u64("fee");
+    view.nonce_ = reader.u64("nonce");
+    view.memo_ = reader.bytes("memo");
+    if (!reader.at_end()) {
+        reader.fail("memo");
+    }
+    return view;
+}
+
+TransactionView TransactionView::parse_text(std::string_view raw) {
     std::size_t cursor = 0;
-    auto consume_token = [&](const char* field_name) {
+    auto consume_number = [&](const char* field_name) {
         const auto sep = raw.find('|', cursor);
-        if (sep == std::string::npos) {
+        if (sep == std::string_view::npos) {
+            throw std::runtime_error(std::string("invalid transaction: ") + field_name);
+        }
+        std::uint64_t value = 0;
+        const auto [end, error] = std::from_chars(raw.data() + cursor, raw.data() + sep, value);
+        if (error != std::errc() || end != raw.data() + sep || sep == cursor) {
             throw std::runtime_error(std::string("invalid transaction: ") + field_name);
         }
-        const auto token = raw.substr(cursor, sep - cursor);
         cursor = sep + 1;
-        return token;
+        return value;
     };
 
-    auto consume_sized = [&](std::size_t size, const char* field_name) {
-        if (raw.size() - cursor < size + 1) {
+    auto consume_sized = [&](std::uint64_t size, const char* field_name) {
+        if (raw.size() - cursor <= size) {
             throw std::runtime_error(std::string("invalid transaction: ") + field_name);
         }
-        const auto out = raw.substr(cursor, size);
-        cursor += size;
+        const auto out = raw.substr(cursor, static_cast<std::size_t>(size));
+        cursor += static_cast<std::size_t>(size);
         if (raw[cursor] != '|') {
             throw std::runtime_error(std::string("invalid transaction: ") + field_name);
         }
@@ -48,41 +206,60 @@ Transaction Transaction::deserialize(const std::string& raw) {
         return out;
     };
 
-    Transaction tx;
+    TransactionView view;
+    view.from_ = consume_sized(consume_number("from_size"), "from");
+    view.to_ = consume_sized(consume_number("to_size"), "to");
+    view.amount_ = consume_number("amount");
+    view.fee_ = consume_number("fee");
+    view.nonce_ = consume_number("nonce");
 
-    const auto from_size = static_cast<std::size_t>(std::stoull(consume_token("from_size")));
-    tx.from = consume_sized(from_size, "from");
-
-    const auto to_size = static_cast<std::size_t>(std::stoull(consume_token("to_size")));
-    tx.to = consume_sized(to_size, "to");
-
-    tx.amount = static_cast<std::uint64_t>(std::stoull(consume_token("amount")));
-    tx.fee = static_cast<std::uint64_t>(std::stoull(consume_token("fee")));
-    tx.nonce = static_cast<std::uint64_t>(std::stoull(consume_token("nonce")));
-
-    const auto memo_size = static_cast<std::size_t>(std::stoull(consume_token("memo_size")));
+    const auto memo_size = consume_number("memo_size");
     if (raw.size() - cursor < memo_size) {
         throw std::runtime_error("invalid transaction: memo");
     }
-    tx.memo = raw.substr(cursor, memo_size);
+    view.memo_ = raw.substr(cursor, static_cast<std::size_t>(memo_size));
+    return view;
+}
 
-    if (!is_valid_transaction(tx)) {
-        throw std::runtime_error("invalid transaction semantic");
+std::vector<Hash256> transaction_ids(const std::vector<Transaction>& txs) {
+    std::vector<const Transaction*> missing;
+    std::string preimages;
+    std::vector<std::size_t> offsets;
+    for (const auto& tx : txs) {
+        if (!tx.has_id_) {
+            missing.push_back(&tx);
+            offsets.push_back(preimages.size());
+            append_id_preimage(preimages, tx);
+        }
     }
-    return tx;
-}
+    offsets.push_back(preimages.size());
 
-bool is_valid_transaction(const Transaction& tx) {
-    if (tx.from.empty() || tx.to.empty()) {
-        return false;
+    std::vector<std::string_view> messages;
+    messages.reserve(missing.size());
+    for (std::size_t i = 0; i < missing.size(); ++i) {
+        messages.push_back(std::string_view(preimages).substr(offsets[i], offsets[i + 1] - offsets[i]));
     }
-    if (tx.amount == 0) {
-        return false;
+    std::vector<Digest256> digests(missing.size());
+    sha256_batch(messages.data(), messages.size(), digests.data());
+    for (std::size_t i = 0; i < missing.size(); ++i) {
+        missing[i]->id_ = Hash256(digests[i]);
+        missing[i]->has_id_ = true;
     }
-    if (tx.from == tx.to) {
-        return false;
+
+    std::vector<Hash256> ids;
+    ids.reserve(txs.size());
+    for (const auto& tx : txs) {
+        ids.push_back(tx.id_);
     }
-    return true;
+    return ids;
+}
+
+bool is_valid_transaction(const Transaction& tx) {
+    return valid_fields(tx.from(), tx.to(), tx.amount());
+}
+
+bool is_valid_transaction(const TransactionView& view) {
+    return valid_fields(view.from(), view.to(), view.amount());
 }
 
 }  // namespace elit21
@@ -1,6 +1,7 @@
 #include "elit21/wallet.hpp"
 
-#include <functional>
+#include "elit21/sha256.hpp"
+
 #include <stdexcept>
 
 namespace elit21 {
@@ -27,13 +28,7 @@ SignedTransaction Wallet::create_signed_payment(const std::string& to,
         throw std::runtime_error("insufficient funds");
     }
 
-    Transaction tx;
-    tx.from = address_;
-    tx.to = to;
-    tx.amount = amount;
-    tx.fee = fee;
-    tx.nonce = nonce_;
-    tx.memo = memo;
+    const Transaction tx(address_, to, amount, fee, nonce_, memo);
 
     if (!is_valid_transaction(tx)) {
         throw std::runtime_error("invalid transaction generated by wallet");
@@ -66,9 +61,8 @@ bool Wallet::verify_signature(const SignedTransaction& signed_tx) const {
     return sign(signed_tx.tx) == signed_tx.signature;
 }
 
-std::string Wallet::sign(const Transaction& tx) const {
-    const auto seed = tx.id() + "|" + address_ + "|" + secret_;
-    return std::to_string(std::hash<std::string>{}(seed));
+Hash256 Wallet::sign(const Transaction& tx) const {
+    return Hash256(hmac_sha256(secret_, tx.id().bytes()));
 }
 
 }  // namespace elit21
@@ -1,13 +1,30 @@
 #include "elit21/blockchain.hpp"
+#include "elit21/codec.hpp"
+#include "elit21/concurrent_mempool.hpp"
+#include "elit21/dictionary.hpp"
 #include "elit21/mempool.hpp"
 #include "elit21/node.hpp"
+#include "elit21/payload.hpp"
+#include "elit21/seen_filter.hpp"
+#include "elit21/sha256.hpp"
+#include "elit21/thread_pool.hpp"
 #include "elit21/transaction.hpp"
 #include "elit21/wallet.hpp"
 
 #include <cassert>
+#include <cstdint>
 #include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
 int main() {
     {
@@ -31,6 +48,525 @@ int main() {
         assert(caught);
     }
 
+    {
+        std::string raw;
+        for (std::size_t run : {1u, 2u, 15u, 16u, 17u, 31u, 32u, 33u, 254u, 255u, 256u, 511u, 1000u}) {
+            raw.append(run, static_cast<char>('a' + run % 26));
+            raw += "|x|";
+        }
+
+        std::string expected;
+        char current = raw.front();
+        std::size_t run = 0;
+        for (const char c : raw) {
+            if (c == current && run < 255) {
+                ++run;
+                continue;
+            }
+            expected.push_back(static_cast<char>(run));
+            expected.push_back(current);
+            current = c;
+            run = 1;
+        }
+        expected.push_back(static_cast<char>(run));
+        expected.push_back(current);
+
+        const auto compressed = elit21::compress_block(raw, "RLE");
+        assert(compressed.bytes == expected);
+        assert(elit21::decompress_block(compressed) == raw);
+        assert(elit21::compress_block("", "RLE").bytes.empty());
+
+        bool caught = false;
+        try {
+            (void)elit21::decompress_block(compressed, raw.size() - 1);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught);
+
+        caught = false;
+        auto zero_run = compressed;
+        zero_run.bytes[zero_run.bytes.size() - 2] = '\0';
+        try {
+            (void)elit21::decompress_block(zero_run);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught);
+    }
+
+    {
+        std::string payload;
+        for (std::uint64_t n = 0; n < 400; ++n) {
+            elit21::Transaction tx{"alice", "bob", 100 + n, n % 5 + 1, n, "invoice-" + std::to_string(n % 40)};
+            const auto raw = tx.serialize();
+            payload += std::to_string(raw.size()) + "\n" + raw + "\n";
+        }
+
+        const auto lz = elit21::compress_block(payload, "LZ");
+        const auto rle = elit21::compress_block(payload, "RLE");
+        assert(lz.codec == elit21::CodecId::Lz);
+        assert(lz.bytes.size() * 3 < rle.bytes.size());
+        assert(elit21::decompress_block(lz) == payload);
+        assert(elit21::decompress_block(elit21::compress_block("", "LZ")).empty());
+        assert(elit21::decompress_block(elit21::compress_block("abcabcabcabcabcabca", "LZ")) == "abcabcabcabcabcabca");
+
+        assert(elit21::find_codec(elit21::CodecId::Lz) == &elit21::lz_codec());
+        assert(elit21::find_codec(elit21::CodecId::Raw)->name() == "RAW");
+        assert(elit21::is_supported_codec("LZ"));
+        assert(elit21::codec_id("LZD") == elit21::CodecId::LzDictionary && !elit21::codec_id("UNKNOWN"));
+        const std::vector<elit21::CodecId> offered{elit21::CodecId::Lz, elit21::CodecId::Raw};
+        assert(elit21::codec_ids({"LZ", "UNKNOWN", "RAW"}) == offered);
+
+        bool caught = false;
+        try {
+            (void)elit21::decompress_block(lz, payload.size() - 1);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught);
+
+        caught = false;
+        auto truncated = lz;
+        truncated.bytes.resize(truncated.bytes.size() / 2);
+        try {
+            (void)elit21::decompress_block(truncated);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught);
+
+        elit21::Blockchain chain("LZ");
+        auto block = chain.create_block(payload);
+        auto compressed = chain.compress_for_transport(block, {"RAW", "LZ"});
+        assert(compressed.codec == elit21::CodecId::Lz);
+        chain.accept_from_network(compressed);
+        assert(chain.chain().size() == 2);
+    }
+
+    {
+        std::string raw;
+        for (int n = 0; n < 300; ++n) {
+            raw += "5|alice|3|bob|" + std::to_string(n) + "|";
+            raw.append(static_cast<std::size_t>(n % 40), '0');
+        }
+
+        std::string arena(raw.size(), '\0');
+        elit21::StreamDecompressor decompressor;
+        for (const auto* codec : {&elit21::raw_codec(), &elit21::rle_codec(), &elit21::lz_codec()}) {
+            const auto compressed = elit21::compress_block(raw, *codec);
+            for (std::size_t chunk : {std::size_t{1}, std::size_t{7}, compressed.bytes.size()}) {
+                decompressor.reset(*codec, arena.data(), arena.size());
+                for (std::size_t pos = 0; pos < compressed.bytes.size(); pos += chunk) {
+                    decompressor.feed(std::string_view(compressed.bytes).substr(pos, chunk));
+                }
+                assert(decompressor.finish() == raw.size());
+                assert(arena == raw);
+            }
+
+            bool caught = false;
+            decompressor.reset(*codec, arena.data(), raw.size() - 1);
+            try {
+                decompressor.feed(compressed.bytes);
+            } catch (const std::runtime_error&) {
+                caught = true;
+            }
+            assert(caught);
+
+            caught = false;
+            decompressor.reset(*codec, arena.data(), arena.size());
+            try {
+                decompressor.feed(std::string_view(compressed.bytes).substr(0, compressed.bytes.size() - 1));
+                (void)decompressor.finish();
+            } catch (const std::runtime_error&) {
+                caught = true;
+            }
+            assert(caught || codec == &elit21::raw_codec());
+        }
+
+        elit21::Blockchain chain("LZ");
+        for (int n = 0; n < 3; ++n) {
+            const auto compressed = chain.compress_for_transport(chain.create_block(raw));
+            chain.begin_network_block(compressed.codec);
+            for (std::size_t pos = 0; pos < compressed.bytes.size(); pos += 64) {
+                chain.feed_network_block(std::string_view(compressed.bytes).substr(pos, 64));
+            }
+            chain.finish_network_block();
+        }
+        assert(chain.chain().size() == 4);
+        assert(chain.chain().back().payload == raw);
+        assert(chain.is_valid());
+    }
+
+    {
+        const auto payload_for = [](std::uint64_t seed) {
+            std::string payload = "8\n";
+            for (std::uint64_t n = seed; n < seed + 8; ++n) {
+                elit21::Transaction tx{"wallet-alice-0001", "wallet-bob-0002", 1'000 + n * 37, n % 3 + 1, n, "settlement"};
+                const auto raw = tx.serialize();
+                payload += std::to_string(raw.size()) + "\n" + raw + "\n";
+            }
+            return payload;
+        };
+
+        elit21::Blockchain chain("LZ");
+        for (std::uint64_t n = 0; n < 32; ++n) {
+            chain.accept_from_network(chain.compress_for_transport(chain.create_block(payload_for(n * 8))));
+        }
+        const auto id = chain.train_dictionary(32, 4096);
+        assert(chain.dictionary_ids() == std::vector<std::string>{id});
+        assert(chain.dictionary(id).content().size() <= 4096);
+
+        const auto block = chain.create_block(payload_for(1'000));
+        const auto plain = chain.compress_for_transport(block, {"LZ", "LZD"}, {"unknown-dictionary"});
+        const auto shared = chain.compress_for_transport(block, {"LZ", "LZD"}, {id});
+        assert(plain.codec == elit21::CodecId::Lz && plain.dictionary_id.empty());
+        assert(shared.codec == elit21::CodecId::LzDictionary && shared.dictionary_id == id);
+        assert(shared.bytes.size() < plain.bytes.size());
+
+        const auto codec = elit21::make_dictionary_codec(
+            std::make_shared<const elit21::CompressionDictionary>(chain.dictionary(id)));
+        assert(codec->decompress(shared.bytes, 1024 * 1024) == block.serialize());
+
+        bool caught = false;
+        elit21::Blockchain stranger("LZ");
+        try {
+            stranger.accept_from_network(shared);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught);
+
+        chain.accept_from_network(shared);
+        assert(chain.chain().size() == 34);
+        assert(chain.is_valid());
+    }
+
+    {
+        elit21::Blockchain chain;
+        for (int n = 0; n < 5; ++n) {
+            chain.accept_from_network(chain.compress_for_transport(chain.create_block("tx:watermark-" + std::to_string(n))));
+        }
+        assert(chain.validated_height() == 6);
+
+        const auto incremental = chain.validate_with_metrics();
+        assert(incremental.valid && incremental.mode == elit21::ValidationMode::Incremental);
+        assert(incremental.first_block_checked == 6 && incremental.blocks_checked == 0);
+
+        const auto full = chain.validate_with_metrics(elit21::ValidationMode::Full);
+        assert(full.valid && full.mode == elit21::ValidationMode::Full);
+        assert(full.first_block_checked == 0 && full.blocks_checked == 6);
+    }
+
+    {
+        elit21::ThreadPool pool(3);
+        std::vector<int> hits(1000, 0);
+        pool.parallel_for(hits.size(), [&](std::size_t task, std::size_t worker) {
+            assert(worker < pool.size());
+            ++hits[task];
+        });
+        for (const auto hit : hits) {
+            assert(hit == 1);
+        }
+
+        bool caught = false;
+        try {
+            pool.parallel_for(10, [](std::size_t task, std::size_t) {
+                if (task == 7) {
+                    throw std::runtime_error("task failed");
+                }
+            });
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught);
+
+        elit21::Blockchain chain("RAW");
+        for (int n = 0; n < 9'000; ++n) {
+            chain.accept_from_network(chain.compress_for_transport(chain.create_block("tx:" + std::to_string(n))));
+        }
+        chain.set_validation_threads(3);
+        const auto report = chain.validate_with_metrics(elit21::ValidationMode::Full);
+        assert(report.valid && report.blocks_checked == 9'001);
+        assert(report.thread_microseconds.size() == 3);
+
+        const auto& headers = chain.headers();
+        assert(headers.size() == chain.height());
+        for (std::size_t h = 0; h < headers.size(); h += 97) {
+            assert(headers.find(headers.hash(h)) == h);
+            assert(h == 0 || headers.header(h).previous_hash == headers.hash(h - 1));
+        }
+        assert(!headers.find(elit21::Hash256(elit21::sha256("unknown"))).has_value());
+        assert(chain.find_block(headers.hash(4'321))->payload == "tx:4320");
+        const auto header_pass = chain.validate_with_metrics(elit21::ValidationMode::Headers);
+        assert(header_pass.valid && header_pass.blocks_checked == 9'001);
+    }
+
+    {
+        elit21::Blockchain source("LZ");
+        std::vector<elit21::CompressedBlock> batch;
+        for (int n = 0; n < 2'500; ++n) {
+            const auto block = source.create_block("tx:" + std::to_string(n));
+            batch.push_back(source.compress_for_transport(block));
+            source.accept_from_network(batch.back());
+        }
+
+        elit21::Blockchain serial("LZ");
+        serial.accept_batch(batch);
+        assert(serial.height() == 2'501 && serial.chain().back().hash == source.chain().back().hash);
+
+        // A bad block stops the batch where a loop over accept_from_network would, with the same error.
+        batch[1'700].bytes.back() ^= 0x01;
+        elit21::Blockchain pooled("LZ");
+        pooled.set_validation_threads(3);
+        std::string error;
+        try {
+            pooled.accept_batch(batch);
+        } catch (const std::runtime_error& e) {
+            error = e.what();
+        }
+        assert(!error.empty() && pooled.height() == 1'701);
+        elit21::Blockchain looped("LZ");
+        std::string loop_error;
+        try {
+            for (const auto& compressed : batch) {
+                looped.accept_from_network(compressed);
+            }
+        } catch (const std::runtime_error& e) {
+            loop_error = e.what();
+        }
+        assert(loop_error == error && looped.height() == 1'701);
+        assert(pooled.is_valid());
+    }
+
+    {
+        elit21::Blockchain source("RAW");
+        std::vector<elit21::CompressedBlock> wire;
+        for (int n = 1; n <= 6; ++n) {
+            wire.push_back(source.compress_for_transport(source.create_block("tx:" + std::to_string(n))));
+            source.accept_from_network(wire.back());
+        }
+
+        elit21::Blockchain chain("RAW");
+        chain.accept_from_network(wire[0]);
+        for (const auto early : {3, 2, 4, 5}) {
+            chain.accept_from_network(wire[static_cast<std::size_t>(early)]);
+        }
+        assert(chain.height() == 2 && chain.orphan_statistics().blocks == 4);
+        chain.accept_from_network(wire[2]);
+        assert(chain.orphan_statistics().blocks == 4);
+        chain.accept_from_network(wire[1]);
+        assert(chain.height() == 7 && chain.chain().back().hash == source.chain().back().hash);
+        auto stats = chain.orphan_statistics();
+        assert(stats.blocks == 0 && stats.bytes == 0 && stats.added == 4 && stats.connected == 4);
+        assert(chain.is_valid());
+
+        elit21::OrphanPolicy policy;
+        policy.max_blocks = 2;
+        elit21::Blockchain capped("RAW");
+        capped.set_orphan_policy(policy);
+        for (std::size_t early = 2; early < 6; ++early) {
+            capped.accept_from_network(wire[early]);
+        }
+        stats = capped.orphan_statistics();
+        assert(stats.blocks == 2 && stats.evicted == 2);
+
+        // Two children of the same missing parent: the first to arrive is linked, the other is dropped.
+        auto fork = source.create_block("tx:fork");
+        fork.header.index = 2;
+        fork.header.previous_hash = source.chain()[1].hash;
+        fork.hash = elit21::compute_hash(fork.header, fork.payload);
+        elit21::Blockchain racing("RAW");
+        racing.accept_from_network(wire[1]);
+        racing.accept_from_network(source.compress_for_transport(fork));
+        racing.accept_from_network(wire[0]);
+        stats = racing.orphan_statistics();
+        assert(racing.height() == 3 && stats.connected == 1 && stats.rejected == 1 && stats.blocks == 0);
+        assert(racing.chain().back().hash == source.chain()[2].hash);
+
+        auto tampered = wire[4];
+        tampered.bytes[tampered.bytes.size() / 2] ^= 0x01;
+        bool caught = false;
+        try {
+            racing.accept_from_network(tampered);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught && racing.orphan_statistics().blocks == 0);
+
+        policy.max_blocks = 0;
+        racing.set_orphan_policy(policy);
+        caught = false;
+        try {
+            racing.accept_from_network(wire[4]);
+        } catch (const std::runtime_error& e) {
+            caught = std::string(e.what()) == "index mismatch";
+        }
+        assert(caught);
+    }
+
+    {
+        const auto directory = std::filesystem::temp_directory_path() / "elit21_block_store_test";
+        std::filesystem::remove_all(directory);
+        elit21::Hash256 tip;
+        {
+            auto chain = elit21::Blockchain::open(directory, "RAW");
+            assert(chain.persistent() && chain.height() == 1);
+            for (int n = 0; n < 2'500; ++n) {
+                chain.accept_from_network(chain.compress_for_transport(chain.create_block("tx:" + std::to_string(n))));
+            }
+            tip = chain.chain().back().hash;
+            assert(chain.chain()[3].payload == "tx:2");
+        }
+
+        auto chain = elit21::Blockchain::open(directory, "RAW");
+        assert(chain.height() == 2'501 && chain.validated_height() == 2'501);
+        assert(chain.chain().back().hash == tip);
+        assert(chain.chain()[10].payload == "tx:9");
+        assert(chain.chain().blocks(5, 8).back().payload == "tx:6");
+        assert(chain.headers().find(tip) == 2'500);
+        assert(chain.validate_with_metrics(elit21::ValidationMode::Headers).valid);
+        const auto full = chain.validate_with_metrics(elit21::ValidationMode::Full);
+        assert(full.valid && full.blocks_checked == 2'501);
+        chain.accept_from_network(chain.compress_for_transport(chain.create_block("tx:reopened")));
+        assert(chain.height() == 2'502);
+
+        // A record torn by a crash is dropped together with its index entry.
+        const auto segment = directory / "blk00000.dat";
+        std::filesystem::resize_file(segment, std::filesystem::file_size(segment) - 3);
+        chain = elit21::Blockchain::open(directory, "RAW");
+        assert(chain.height() == 2'501 && chain.chain().back().hash == tip);
+        assert(chain.is_valid());
+
+        // Index entries torn by a crash: a zero-filled one, and a stale copy that points inside the segment.
+        {
+            const auto index = directory / "index.dat";
+            std::string last(88, '\0');
+            {
+                std::ifstream in(index, std::ios::binary);
+                in.seekg(-88, std::ios::end);
+                in.read(last.data(), static_cast<std::streamsize>(last.size()));
+            }
+            std::ofstream out(index, std::ios::binary | std::ios::app);
+            out << last << std::string(88, '\0');
+        }
+        chain = elit21::Blockchain::open(directory, "RAW");
+        assert(chain.height() == 2'501 && chain.chain().back().hash == tip);
+        std::filesystem::resize_file(directory / "index.dat", std::filesystem::file_size(directory / "index.dat") + 88);
+        chain = elit21::Blockchain::open(directory, "RAW");
+        assert(chain.height() == 2'501 && chain.is_valid());
+        std::filesystem::remove_all(directory);
+    }
+
+    {
+        elit21::Blockchain source("RAW");
+        for (int n = 0; n < 5; ++n) {
+            source.accept_from_network(source.compress_for_transport(source.create_block("tx:" + std::to_string(n))));
+        }
+        const auto directory = std::filesystem::temp_directory_path() / "elit21_block_store_watermark_test";
+        std::filesystem::remove_all(directory);
+        {
+            auto chain = elit21::Blockchain::open(directory, "RAW");
+            chain.begin_initial_download({5, source.headers().hash(5)});
+            for (const auto& block : source.blocks(1, 4)) {
+                chain.accept_block(block);
+            }
+            assert(chain.height() == 4 && chain.validated_height() == 1);
+        }
+
+        // Blocks linked under assume-valid and never checked are not trusted on reopen.
+        auto chain = elit21::Blockchain::open(directory, "RAW");
+        assert(chain.height() == 4 && chain.validated_height() == 1);
+        const auto report = chain.validate_with_metrics();
+        assert(report.valid && report.first_block_checked == 1 && report.blocks_checked == 3);
+        chain = elit21::Blockchain::open(directory, "RAW");
+        assert(chain.validated_height() == 4);
+        std::filesystem::remove_all(directory);
+
+        // A history rejected by the deferred pass is cut from the store as well.
+        {
+            auto fresh = elit21::Blockchain::open(directory, "RAW");
+            auto tampered = source.blocks(1, 4);
+            tampered[1].header.timestamp += 1;
+            fresh.begin_initial_download({3, source.headers().hash(3)});
+            fresh.accept_block(tampered[0]);
+            fresh.accept_block(tampered[1]);
+            bool caught = false;
+            try {
+                fresh.accept_block(tampered[2]);
+            } catch (const std::runtime_error&) {
+                caught = true;
+            }
+            assert(caught && fresh.height() == 1 && !fresh.in_initial_download());
+            fresh.accept_block(source.block_at(1));
+            assert(fresh.height() == 2 && fresh.validated_height() == 2);
+        }
+        chain = elit21::Blockchain::open(directory, "RAW");
+        assert(chain.height() == 2 && chain.validated_height() == 2);
+        assert(chain.headers().hash(1) == source.headers().hash(1) && chain.is_valid());
+        std::filesystem::remove_all(directory);
+
+        // The checkpoint block arriving ahead of its parent links from the orphan pool; the rejected history
+        // still surfaces as an error instead of being counted as one more bad orphan.
+        elit21::Blockchain unordered("RAW");
+        auto reordered = source.blocks(1, 5);
+        reordered[1].header.timestamp += 1;
+        unordered.begin_initial_download({4, source.headers().hash(4)});
+        unordered.accept_block(reordered[0]);
+        unordered.accept_block(reordered[1]);
+        unordered.accept_block(reordered[3]);
+        assert(unordered.height() == 3 && unordered.orphan_statistics().blocks == 1);
+        bool caught = false;
+        try {
+            unordered.accept_block(reordered[2]);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught && unordered.height() == 1 && !unordered.in_initial_download());
+        assert(unordered.orphan_statistics().blocks == 0 && unordered.orphan_statistics().rejected == 1);
+    }
+
+    {
+        elit21::Blockchain chain("RLE");
+        std::string text;
+        for (std::uint64_t n = 0; text.size() < 32 * 1024; ++n) {
+            text += "memo-" + std::to_string(n * 7919) + ";";
+        }
+        const auto block = chain.create_block(text);
+        assert(chain.compress_for_transport(block, {"RLE", "RAW"}).codec == elit21::CodecId::Rle);
+
+        elit21::AdaptiveCodecPolicy policy;
+        policy.enabled = true;
+        policy.max_encode_nanoseconds_per_kib = 1'000'000'000;
+        chain.set_adaptive_codec_policy(policy);
+        const auto fallback = chain.compress_for_transport(block, {"RLE", "RAW"});
+        assert(fallback.codec == elit21::CodecId::Raw);
+        const auto best = chain.compress_for_transport(block, {"RLE", "RAW", "LZ"});
+        assert(best.codec == elit21::CodecId::Lz);
+        assert(best.bytes.size() < block.serialize().size());
+        chain.accept_from_network(best);
+
+        bool saw_lz = false;
+        for (const auto& entry : chain.codec_statistics()) {
+            if (entry.codec == "LZ") {
+                saw_lz = true;
+                assert(entry.encoded_blocks == 1 && entry.decoded_blocks == 1);
+                assert(entry.encode_bytes_out == best.bytes.size() && entry.decode_bytes_in == best.bytes.size());
+                assert(entry.decode_bytes_out == entry.encode_bytes_in);
+            }
+        }
+        assert(saw_lz);
+
+        bool caught = false;
+        policy.max_encode_nanoseconds_per_kib = 0;
+        try {
+            chain.set_adaptive_codec_policy(policy);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught);
+    }
+
     {
         bool caught = false;
         elit21::Blockchain chain;
@@ -52,7 +588,7 @@ int main() {
         elit21::Blockchain chain("RLE");
         auto block = chain.create_block("tx:raw-fallback");
         auto compressed = chain.compress_for_transport(block, {"RAW", "UNKNOWN"});
-        assert(compressed.codec == "RAW");
+        assert(compressed.codec == elit21::CodecId::Raw);
         chain.accept_from_network(compressed);
         assert(chain.chain().size() == 2);
     }
@@ -71,21 +607,158 @@ int main() {
 
     {
         elit21::Transaction tx;
-        tx.from = "alice";
-        tx.to = "bob";
-        tx.amount = 10;
-        tx.fee = 1;
-        tx.nonce = 7;
-        tx.memo = "memo::with|pipes";
+        tx.set_from("alice");
+        tx.set_to("bob");
+        tx.set_amount(10);
+        tx.set_fee(1);
+        tx.set_nonce(7);
+        tx.set_memo("memo::with|pipes");
 
         const auto raw = tx.serialize();
         const auto decoded = elit21::Transaction::deserialize(raw);
-        assert(decoded.from == tx.from);
-        assert(decoded.to == tx.to);
-        assert(decoded.amount == tx.amount);
-        assert(decoded.fee == tx.fee);
-        assert(decoded.nonce == tx.nonce);
-        assert(decoded.memo == tx.memo);
+        assert(decoded.from() == tx.from());
+        assert(decoded.to() == tx.to());
+        assert(decoded.amount() == tx.amount());
+        assert(decoded.fee() == tx.fee());
+        assert(decoded.nonce() == tx.nonce());
+        assert(decoded.memo() == tx.memo());
+
+        const auto legacy = elit21::Transaction::deserialize(tx.serialize_text());
+        assert(legacy.id() == tx.id());
+
+        // The id follows the fields: a setter drops the cached value and a copy carries it.
+        auto bumped = decoded;
+        assert(bumped.id() == tx.id());
+        bumped.set_fee(2);
+        assert(bumped.id() != tx.id() && bumped.id() == elit21::Transaction("alice", "bob", 10, 2, 7, tx.memo()).id());
+        bumped.set_fee(1);
+        assert(bumped.id() == tx.id());
+
+        const auto view = elit21::TransactionView::parse(raw);
+        assert(view.memo() == tx.memo() && view.nonce() == 7);
+        assert(view.memo().data() >= raw.data() && view.memo().data() < raw.data() + raw.size());
+
+        bool caught = false;
+        try {
+            (void)elit21::TransactionView::parse(std::string_view(raw).substr(0, raw.size() - 1));
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught);
+    }
+
+    {
+        assert(elit21::to_hex(elit21::sha256("abc")) ==
+               "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        assert(elit21::to_hex(elit21::sha256("")) ==
+               "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+        assert(elit21::to_hex(elit21::hmac_sha256("Jefe", "what do ya want for nothing?")) ==
+               "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+
+        const std::string long_input(1'000'000, 'a');
+        elit21::Sha256 incremental;
+        for (std::size_t i = 0; i < long_input.size(); i += 61) {
+            incremental.update(std::string_view(long_input).substr(i, 61));
+        }
+        assert(elit21::to_hex(incremental.finish()) ==
+               "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+        std::vector<std::string> inputs;
+        for (std::size_t n = 0; n < 19; ++n) {
+            inputs.push_back(std::string(n * 29 % 200, static_cast<char>('a' + n)));
+        }
+        const std::vector<std::string_view> views(inputs.begin(), inputs.end());
+        std::vector<elit21::Digest256> digests(views.size());
+        elit21::sha256_batch(views.data(), views.size(), digests.data());
+        for (std::size_t i = 0; i < views.size(); ++i) {
+            assert(digests[i] == elit21::sha256(views[i]));
+        }
+
+        elit21::Blockchain chain;
+        for (int n = 0; n < 10; ++n) {
+            chain.accept_from_network(chain.compress_for_transport(chain.create_block("tx:" + std::to_string(n))));
+        }
+        const auto hashes = elit21::compute_hashes(chain.chain().blocks(0, chain.chain().size()));
+        for (std::size_t i = 0; i < hashes.size(); ++i) {
+            assert(hashes[i] == chain.chain()[i].hash);
+        }
+
+        const std::vector<elit21::Transaction> txs = {{"alice", "bob", 5, 1, 0, ""}, {"bob", "carol", 7, 2, 3, "m"}};
+        const auto ids = elit21::transaction_ids(txs);
+        assert(ids[0] == txs[0].id() && ids[1] == txs[1].id() && ids[0] != ids[1]);
+    }
+
+    {
+        const auto digest = elit21::Hash256(elit21::sha256("abc"));
+        const auto hex = digest.to_hex();
+        assert(elit21::Hash256::from_hex(hex) == digest);
+        assert(elit21::Hash256::from_bytes(digest.bytes()) == digest);
+        assert(elit21::Hash256{}.is_zero() && !digest.is_zero());
+
+        auto flipped = hex;
+        flipped.back() = flipped.back() == '0' ? '1' : '0';
+        assert(elit21::Hash256::from_hex(flipped) != digest);
+
+        std::unordered_set<elit21::Hash256> seen{digest, elit21::Hash256{}};
+        assert(seen.count(elit21::Hash256::from_hex(hex)) == 1 && seen.size() == 2);
+
+        bool caught = false;
+        try {
+            (void)elit21::Hash256::from_hex(hex.substr(1) + "z");
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught);
+
+        elit21::Blockchain chain;
+        assert(chain.chain().front().header.previous_hash.is_zero());
+        const auto block = chain.create_block("tx:v1");
+        std::string v1(elit21::kBlockMagic);
+        v1 += '\x01';
+        for (int shift = 0; shift < 32; shift += 8) {
+            v1 += static_cast<char>((block.header.index >> shift) & 0xFFU);
+        }
+        for (int shift = 0; shift < 64; shift += 8) {
+            v1 += static_cast<char>((block.header.timestamp >> shift) & 0xFFU);
+        }
+        v1 += '\x20';
+        v1 += block.header.previous_hash.bytes();
+        v1 += static_cast<char>(block.payload.size());
+        v1 += block.payload;
+        v1 += '\x20';
+        v1 += block.hash.bytes();
+        const auto decoded = elit21::Block::deserialize(v1);
+        assert(decoded.hash == block.hash && decoded.header.previous_hash == block.header.previous_hash);
+        assert(decoded.payload == block.payload);
+    }
+
+    {
+        elit21::Blockchain chain;
+        const auto block = chain.create_block(std::string("bin\0ary|payload", 15));
+        const auto binary = block.serialize();
+        assert(binary.compare(0, elit21::kBlockMagic.size(), elit21::kBlockMagic) == 0);
+        assert(binary.size() < block.serialize_text().size());
+
+        const auto view = elit21::BlockView::parse(binary);
+        assert(view.index() == block.header.index && view.timestamp() == block.header.timestamp);
+        assert(view.previous_hash() == block.header.previous_hash);
+        assert(view.payload() == block.payload && view.hash() == block.hash);
+
+        const auto from_text = elit21::Block::deserialize(block.serialize_text());
+        assert(from_text.payload == block.payload && from_text.hash == block.hash);
+
+        chain.accept_from_network(elit21::compress_block(block.serialize_text(), "RAW"));
+        assert(chain.chain().size() == 2);
+
+        for (const auto size : {std::size_t{4}, std::size_t{6}, binary.size() - 1}) {
+            bool caught = false;
+            try {
+                (void)elit21::Block::deserialize(std::string_view(binary).substr(0, size));
+            } catch (const std::runtime_error&) {
+                caught = true;
+            }
+            assert(caught);
+        }
     }
 
     {
@@ -103,7 +776,7 @@ int main() {
 
         const auto selected = mempool.select_for_block(2);
         assert(selected.size() == 2);
-        assert(selected[0].fee >= selected[1].fee);
+        assert(selected[0].fee() >= selected[1].fee());
 
         try {
             mempool.add(high_fee);
@@ -113,6 +786,439 @@ int main() {
         assert(caught);
     }
 
+    {
+        elit21::Mempool mempool;
+        const elit21::Transaction late_nonce{"carol", "dave", 1, 5, 7, ""};
+        const elit21::Transaction early_nonce{"erin", "dave", 1, 5, 2, ""};
+        const elit21::Transaction first_arrival{"frank", "dave", 1, 5, 2, "a"};
+        const elit21::Transaction cheap{"gina", "dave", 1, 1, 0, ""};
+        const elit21::Transaction rich{"hal", "dave", 1, 8, 9, ""};
+        for (const auto& tx : {late_nonce, first_arrival, early_nonce, cheap, rich}) {
+            mempool.add(tx);
+        }
+        assert(mempool.contains(early_nonce.id()) && !mempool.contains(elit21::Hash256{}));
+
+        auto selected = mempool.select_for_block(4);
+        assert(selected.size() == 4);
+        assert(selected[0].id() == rich.id() && selected[1].id() == first_arrival.id());
+        assert(selected[2].id() == early_nonce.id() && selected[3].id() == late_nonce.id());
+
+        mempool.remove_committed({rich, early_nonce});
+        assert(mempool.size() == 3 && !mempool.contains(rich.id()));
+        selected = mempool.select_for_block(10);
+        assert(selected.size() == 3 && selected.back().id() == cheap.id());
+    }
+
+    {
+        elit21::Mempool mempool;
+        const elit21::Transaction n4{"alice", "bob", 10, 1, 4, ""};
+        const elit21::Transaction n5{"alice", "bob", 10, 9, 5, ""};
+        const elit21::Transaction n6{"alice", "bob", 50, 2, 6, ""};
+        const elit21::Transaction n8{"alice", "bob", 1, 20, 8, ""};
+        const elit21::Transaction other{"carol", "bob", 1, 3, 0, ""};
+        for (const auto& tx : {n5, n8, n6, n4, other}) {
+            mempool.add(tx);
+        }
+
+        // n5 outbids everything but waits for n4; n8 waits behind the gap at nonce 7.
+        auto selected = mempool.select_for_block(10);
+        assert(selected.size() == 4);
+        assert(selected[0].id() == other.id() && selected[1].id() == n4.id());
+        assert(selected[2].id() == n5.id() && selected[3].id() == n6.id());
+
+        // 11 + 19 fit in alice's 40, n6 would take her to 82; dave has no balance entry at all.
+        mempool.add(elit21::Transaction{"dave", "bob", 1, 50, 0, ""});
+        selected = mempool.select_for_block(10, {{"alice", 40}, {"carol", 3}});
+        assert(selected.size() == 2);
+        assert(selected[0].id() == n4.id() && selected[1].id() == n5.id());
+    }
+
+    {
+        elit21::Mempool mempool;
+        const elit21::Transaction bulky{"alice", "bob", 1, 40, 0, std::string(400, 'm')};
+        const elit21::Transaction dense{"carol", "bob", 1, 10, 0, ""};
+        const elit21::Transaction follow_up{"carol", "bob", 1, 9, 1, ""};
+        const elit21::Transaction thrifty{"dave", "bob", 1, 2, 0, ""};
+        for (const auto& tx : {bulky, dense, follow_up, thrifty}) {
+            mempool.add(tx);
+        }
+        const auto bytes = [](const elit21::Transaction& tx) {
+            const auto size = tx.serialize().size();
+            return std::to_string(size).size() + size + 2;
+        };
+        const std::map<std::string, std::uint64_t> balances{{"alice", 100}, {"carol", 100}, {"dave", 100}};
+
+        // bulky pays the most in total but less per byte than carol's; once hers are in it no longer fits, and
+        // the cheaper but smaller thrifty fills the gap.
+        const auto budget = bytes(dense) + bytes(follow_up) + bytes(thrifty) + bytes(bulky) / 2;
+        auto chosen = mempool.block_template(10, budget, balances);
+        assert(chosen.size() == 3);
+        assert(chosen[0].id() == dense.id() && chosen[1].id() == follow_up.id() && chosen[2].id() == thrifty.id());
+
+        chosen = mempool.block_template(10, 1'000'000, balances);
+        assert(chosen.size() == 4 && chosen[2].id() == bulky.id() && chosen[3].id() == thrifty.id());
+        chosen = mempool.block_template(2, 1'000'000, balances);
+        assert(chosen.size() == 2);
+
+        // Removing carol's head promotes her next nonce into the index.
+        mempool.remove_committed({dense});
+        chosen = mempool.block_template(10, 1'000'000, {{"carol", 100}});
+        assert(chosen.size() == 1 && chosen[0].id() == follow_up.id());
+    }
+
+    {
+        elit21::Node node;
+        node.register_wallet("alice", "alice-secret", 1000);
+        node.register_wallet("bob", "bob-secret", 0);
+        for (int i = 0; i < 4; ++i) {
+            node.submit(node.wallet("alice").create_signed_payment("bob", 1, 1, std::string(300 * 1024, 'x')));
+        }
+        // Four 300 KiB memos exceed the 1 MiB transport limit; the template stops at three.
+        const auto block = node.forge_block_from_mempool(10);
+        assert(block.serialize().size() <= node.chain().max_transport_block_bytes());
+        node.commit_local_block(block);
+        assert(node.mempool_size() == 1 && node.wallet("bob").balance() == 3);
+    }
+
+    {
+        elit21::SeenFilter filter({1'000, 0.01, 64});
+        const auto id_of = [](std::uint64_t n) { return elit21::Transaction{"alice", "bob", 1, 1, n, ""}.id(); };
+        for (std::uint64_t n = 0; n < 2'500; ++n) {
+            filter.insert(id_of(n));
+        }
+        // The last 1000 inserts are always remembered; the 64 most recent ones exactly.
+        for (std::uint64_t n = 1'500; n < 2'500; ++n) {
+            assert(filter.contains(id_of(n)));
+        }
+        std::size_t false_positives = 0;
+        for (std::uint64_t n = 10'000; n < 20'000; ++n) {
+            false_positives += filter.contains(id_of(n)) ? 1 : 0;
+        }
+        assert(false_positives < 300);
+        const auto stats = filter.statistics();
+        assert(stats.inserted == 2'500 && stats.rotations == 2 && stats.exact_hits == 64);
+        assert(stats.hash_functions > 0 && stats.memory_bytes >= 2 * stats.bits_per_generation / 8);
+        assert(stats.estimated_false_positive_rate > 0.0 && stats.estimated_false_positive_rate < 0.02);
+
+        elit21::SeenFilter disabled({0, 0.01, 64});
+        disabled.insert(id_of(1));
+        assert(!disabled.contains(id_of(1)) && disabled.statistics().memory_bytes == 0);
+    }
+
+    {
+        elit21::Node node;
+        node.register_wallet("alice", "alice-secret", 1000);
+        node.register_wallet("bob", "bob-secret", 0);
+        const auto payment = node.wallet("alice").create_signed_payment("bob", 10, 1, "once");
+        node.submit(payment);
+        node.commit_local_block(node.forge_block_from_mempool(10));
+        assert(node.mempool_size() == 0);
+
+        // Resubmitting the committed payment is refused before the signature is checked again.
+        bool caught = false;
+        try {
+            node.submit(payment);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught && node.mempool_size() == 0);
+        assert(node.seen_filter_statistics().inserted == 1 && node.seen_filter_statistics().exact_hits == 1);
+
+        node.set_seen_filter_policy({0, 0.01, 0});
+        node.submit(payment);
+        assert(node.mempool_size() == 1);
+    }
+
+    {
+        // A filter small enough that a Bloom collision is found within a few candidates.
+        const elit21::SeenFilterPolicy policy{64, 0.5, 1};
+        elit21::Node node;
+        node.register_wallet("alice", "alice-secret", 1'000);
+        node.register_wallet("bob", "bob-secret", 0);
+        node.set_seen_filter_policy(policy);
+        elit21::SeenFilter replica(policy);
+        for (std::uint64_t n = 0; n < 64; ++n) {
+            // Self-transfers are invalid, so each one is recorded as seen unless it already collides.
+            const auto invalid = elit21::SignedTransaction{elit21::Transaction("alice", "alice", 1, 1, n, ""), {}};
+            const auto status = node.submit_batch({invalid})[0];
+            assert(status == elit21::SubmitStatus::Invalid || status == elit21::SubmitStatus::ProbablySeen);
+            if (status == elit21::SubmitStatus::Invalid) {
+                replica.insert(invalid.tx.id());
+            }
+        }
+        const auto earlier_probable_hits = node.seen_filter_statistics().probable_hits;
+
+        elit21::SignedTransaction colliding;
+        for (int n = 0; n < 1'000; ++n) {
+            colliding = node.wallet("alice").create_signed_payment("bob", 1, 1, "probe-" + std::to_string(n));
+            if (replica.match(colliding.tx.id()) == elit21::SeenMatch::Probable) {
+                break;
+            }
+        }
+        assert(replica.match(colliding.tx.id()) == elit21::SeenMatch::Probable);
+
+        // Never seen and properly signed, yet the Bloom match refuses it: reported as probable, not as seen.
+        assert(node.submit_batch({colliding})[0] == elit21::SubmitStatus::ProbablySeen);
+        std::string error;
+        try {
+            node.submit(colliding);
+        } catch (const std::runtime_error& e) {
+            error = e.what();
+        }
+        assert(error == "transaction probably already seen" && node.mempool_size() == 0);
+        assert(node.seen_filter_statistics().probable_hits == earlier_probable_hits + 2);
+    }
+
+    {
+        const auto make_node = [] {
+            elit21::Node node;
+            node.register_wallet("alice", "alice-secret", 1'000'000);
+            node.register_wallet("bob", "bob-secret", 5);
+            return node;
+        };
+        auto looped = make_node();
+        auto batched = make_node();
+        batched.set_submit_threads(4);
+
+        std::vector<elit21::SignedTransaction> batch;
+        for (int i = 0; i < 300; ++i) {
+            batch.push_back(looped.wallet("alice").create_signed_payment("bob", 1 + i, 1, "burst"));
+        }
+        auto forged = batch[10];
+        forged.signature = batch[11].signature;
+        batch.push_back(forged);
+        batch.push_back(batch[3]);
+        batch.push_back(looped.wallet("bob").create_signed_payment("alice", 5, 0));
+        batch.back().tx.set_amount(50);
+        batch.push_back(elit21::SignedTransaction{elit21::Transaction("carol", "bob", 1, 1, 0, ""), {}});
+        batch.push_back(elit21::SignedTransaction{elit21::Transaction("alice", "alice", 1, 1, 0, ""), {}});
+
+        std::vector<elit21::SubmitStatus> expected;
+        for (const auto& signed_tx : batch) {
+            try {
+                looped.submit(signed_tx);
+                expected.push_back(elit21::SubmitStatus::Accepted);
+            } catch (const std::runtime_error& error) {
+                expected.push_back(elit21::SubmitStatus::Accepted);
+                for (auto status : {elit21::SubmitStatus::AlreadySeen, elit21::SubmitStatus::ProbablySeen,
+                                    elit21::SubmitStatus::Invalid,
+                                    elit21::SubmitStatus::UnknownSender, elit21::SubmitStatus::UnknownReceiver,
+                                    elit21::SubmitStatus::InvalidSignature, elit21::SubmitStatus::InsufficientBalance,
+                                    elit21::SubmitStatus::Duplicate, elit21::SubmitStatus::ReplacementFeeTooLow,
+                                    elit21::SubmitStatus::MempoolFull}) {
+                    if (std::string(error.what()) == elit21::describe(status)) {
+                        expected.back() = status;
+                    }
+                }
+            }
+        }
+        const auto statuses = batched.submit_batch(batch);
+        assert(statuses == expected);
+        assert(statuses[300] == elit21::SubmitStatus::InvalidSignature);
+        assert(statuses[301] == elit21::SubmitStatus::Duplicate);
+        assert(statuses[302] == elit21::SubmitStatus::InvalidSignature);
+        assert(statuses[303] == elit21::SubmitStatus::UnknownSender);
+        assert(statuses[304] == elit21::SubmitStatus::Invalid);
+        assert(batched.mempool_size() == 300 && looped.mempool_size() == 300);
+
+        // The invalid one is now in the seen filter; the rest of a resubmitted batch is refused by the mempool.
+        const auto again = batched.submit_batch({batch[304], batch[0]});
+        assert(again[0] == elit21::SubmitStatus::AlreadySeen && again[1] == elit21::SubmitStatus::Duplicate);
+
+        // Two copies of one invalid transaction in a batch: the first is recorded, so the second is already seen,
+        // exactly as with two calls to submit.
+        const elit21::SignedTransaction self_transfer{elit21::Transaction("alice", "alice", 2, 1, 7, ""), {}};
+        const auto twice = batched.submit_batch({self_transfer, batch[0], self_transfer});
+        assert(twice[0] == elit21::SubmitStatus::Invalid && twice[1] == elit21::SubmitStatus::Duplicate);
+        assert(twice[2] == elit21::SubmitStatus::AlreadySeen);
+        assert(looped.submit_batch({self_transfer})[0] == elit21::SubmitStatus::Invalid);
+        bool caught = false;
+        try {
+            looped.submit(self_transfer);
+        } catch (const std::runtime_error& e) {
+            caught = std::string(e.what()) == elit21::describe(elit21::SubmitStatus::AlreadySeen);
+        }
+        assert(caught);
+    }
+
+    {
+        elit21::Node node;
+        node.register_wallet("alice", "alice-secret", 10'000'000);
+        node.register_wallet("bob", "bob-secret", 0);
+        node.register_wallet("carol", "carol-secret", 0);
+        std::string payload = "2000\n";
+        std::uint64_t spent = 0;
+        for (std::uint64_t n = 0; n < 2'000; ++n) {
+            const elit21::Transaction tx("alice", n % 2 ? "bob" : "carol", 1 + n, 1, n, n % 7 ? "" : "bulk");
+            assert(elit21::TransactionView::parse(tx.serialize()).id() == tx.id());
+            const auto raw = n % 3 ? tx.serialize() : tx.serialize_text();
+            payload += std::to_string(raw.size()) + '\n' + raw + '\n';
+            spent += tx.amount() + tx.fee();
+        }
+        node.commit_local_block(node.chain().create_block(payload));
+        assert(node.wallet("alice").balance() == 10'000'000 - spent);
+        assert(node.wallet("bob").balance() + node.wallet("carol").balance() == spent - 2'000);
+        assert(node.chain().chain().size() == 2);
+
+        const auto refused = [&node](const std::string& bad) {
+            try {
+                node.commit_local_block(node.chain().create_block(bad));
+            } catch (const std::runtime_error&) {
+                return true;
+            }
+            return false;
+        };
+        const auto one = elit21::Transaction("alice", "bob", 1, 1, 0, "").serialize();
+        assert(refused("x\n"));
+        assert(refused("99999999\n"));
+        assert(refused("1\n" + std::to_string(one.size() + 5) + "\n" + one + "\n"));
+        assert(refused("1\n" + std::to_string(one.size()) + "\n" + one + "|"));
+        assert(refused("1\n" + std::to_string(one.size()) + "\n" + one));
+        assert(node.chain().chain().size() == 2);
+    }
+
+    {
+        std::vector<elit21::Transaction> txs;
+        std::string expected = "150\n";
+        for (std::uint64_t n = 0; n < 150; ++n) {
+            txs.emplace_back("alice", "bob", 1 + n, 1, n, std::string(n, 'p'));
+            const auto raw = txs.back().serialize();
+            assert(raw.size() == txs.back().serialized_size());
+            assert(elit21::PayloadBuilder::encoded_size(txs.back()) == std::to_string(raw.size()).size() + raw.size() + 2);
+            expected += std::to_string(raw.size()) + '\n' + raw + '\n';
+        }
+        elit21::PayloadBuilder builder;
+        assert(builder.build(txs) == expected);
+        assert(builder.capacity() >= expected.size());
+
+        // A smaller payload reuses the buffer; the pointer form writes the same bytes.
+        const auto* buffer = builder.build(txs).data();
+        std::vector<const elit21::Transaction*> subset{&txs[3], &txs[1]};
+        const auto& small = builder.build(subset);
+        assert(small.data() == buffer);
+        assert(small == "2\n" + std::to_string(txs[3].serialized_size()) + '\n' + txs[3].serialize() + "\n" +
+                            std::to_string(txs[1].serialized_size()) + '\n' + txs[1].serialize() + "\n");
+        assert(builder.build(std::vector<elit21::Transaction>{}) == "0\n");
+
+        elit21::Node node;
+        node.register_wallet("alice", "alice-secret", 1'000'000);
+        node.register_wallet("bob", "bob-secret", 0);
+        for (int round = 0; round < 3; ++round) {
+            for (int i = 0; i < 50; ++i) {
+                node.submit(node.wallet("alice").create_signed_payment("bob", 2, 1, "forge"));
+            }
+            node.commit_local_block(node.forge_block_from_mempool(100));
+            assert(node.mempool_size() == 0);
+        }
+        assert(node.wallet("bob").balance() == 300 && node.chain().chain().size() == 4);
+    }
+
+    {
+        elit21::Mempool mempool(2);
+        const elit21::Transaction original{"alice", "bob", 10, 2, 0, ""};
+        const elit21::Transaction bump{"alice", "bob", 10, 5, 0, "bump"};
+        const elit21::Transaction lowball{"alice", "bob", 10, 1, 0, "lowball"};
+        mempool.add(original);
+        mempool.add(bump);
+        assert(mempool.size() == 1 && mempool.contains(bump.id()) && !mempool.contains(original.id()));
+        bool caught = false;
+        try {
+            mempool.add(lowball);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught && mempool.contains(bump.id()));
+
+        const elit21::Transaction cheap{"carol", "bob", 1, 1, 0, ""};
+        const elit21::Transaction pricey{"dave", "bob", 1, 3, 0, ""};
+        const elit21::Transaction outbid{"erin", "bob", 1, 1, 0, ""};
+        mempool.add(cheap);
+        mempool.add(pricey);
+        assert(mempool.size() == 2 && !mempool.contains(cheap.id()) && mempool.contains(pricey.id()));
+        caught = false;
+        try {
+            mempool.add(outbid);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught);
+        const auto& stats = mempool.statistics();
+        assert(stats.replaced == 1 && stats.evicted == 1 && stats.rejected == 2);
+    }
+
+    {
+        elit21::ConcurrentMempool mempool(4'000, 8);
+        std::vector<std::thread> submitters;
+        for (int t = 0; t < 4; ++t) {
+            submitters.emplace_back([&mempool, t] {
+                const auto sender = "sender" + std::to_string(t);
+                for (std::uint64_t nonce = 0; nonce < 200; ++nonce) {
+                    mempool.add(elit21::Transaction{sender, "bob", 1, 1 + nonce % 7, nonce, ""});
+                }
+                // Every replacement of this sender's nonce 0 outbids the last one.
+                for (std::uint64_t fee = 2; fee < 12; ++fee) {
+                    mempool.add(elit21::Transaction{sender, "bob", 1, fee, 0, "bump"});
+                }
+            });
+        }
+        for (auto& submitter : submitters) {
+            submitter.join();
+        }
+        assert(mempool.size() == 800);
+        assert(mempool.statistics().replaced == 40 && mempool.statistics().evicted == 0);
+        const elit21::Transaction top{"sender2", "bob", 1, 11, 0, "bump"};
+        assert(mempool.contains(top.id()));
+
+        bool caught = false;
+        try {
+            mempool.add(elit21::Transaction{"sender2", "bob", 1, 11, 0, "same fee"});
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught && mempool.statistics().rejected == 1);
+
+        const auto selected = mempool.select_for_block(6);
+        assert(selected.size() == 6);
+        for (std::size_t i = 0; i < 4; ++i) {
+            assert(selected[i].fee() == 11 && selected[i].nonce() == 0);
+        }
+        const auto all = mempool.snapshot();
+        assert(all.size() == 800);
+        for (std::size_t i = 1; i < all.size(); ++i) {
+            assert(all[i - 1].fee() >= all[i].fee());
+        }
+
+        mempool.remove_committed({top});
+        assert(mempool.size() == 799 && !mempool.contains(top.id()));
+
+        // Block selection keeps Mempool's nonce rules: a cheap nonce 0 goes before its pricier successor, and
+        // nothing past a gap is taken however much it pays.
+        elit21::ConcurrentMempool ordered(100, 4);
+        elit21::Mempool reference(100);
+        for (const auto& tx : {elit21::Transaction{"carol", "bob", 1, 1, 0, ""}, elit21::Transaction{"carol", "bob", 1, 50, 1, ""},
+                               elit21::Transaction{"carol", "bob", 1, 90, 3, ""}, elit21::Transaction{"dave", "bob", 1, 20, 0, ""},
+                               elit21::Transaction{"dave", "bob", 30, 5, 1, ""}}) {
+            ordered.add(tx);
+            reference.add(tx);
+        }
+        const auto picked = ordered.select_for_block(10);
+        assert(picked.size() == 4 && picked[0].from() == "dave" && picked[1].fee() == 5);
+        assert(picked[2].nonce() == 0 && picked[3].fee() == 50);
+        assert(transaction_ids(picked) == transaction_ids(reference.select_for_block(10)));
+        const std::map<std::string, std::uint64_t> balances{{"carol", 100}, {"dave", 30}};
+        assert(transaction_ids(ordered.select_for_block(10, balances)) ==
+               transaction_ids(reference.select_for_block(10, balances)));
+        assert(ordered.select_for_block(10, balances).size() == 3);
+
+        // Under sustained eviction churn the slots of evicted senders go with their transactions.
+        elit21::ConcurrentMempool churn(8, 2);
+        for (std::uint64_t n = 0; n < 200; ++n) {
+            churn.add(elit21::Transaction{"churn" + std::to_string(n), "bob", 1, 1 + n, 0, ""});
+        }
+        assert(churn.size() <= 8 && churn.statistics().evicted >= 192);
+        assert(churn.tracked_senders() == churn.size());
+    }
+
     {
         elit21::Wallet alice("alice", "s3cr3t", 100);
         auto signed_tx = alice.create_signed_payment("bob", 30, 2, "invoice#42");
@@ -159,19 +1265,32 @@ int main() {
         auto payment2 = node.wallet("alice").create_signed_payment("bob", 60, 1, "overspend-2");
         node.submit(payment1);
         node.submit(payment2);
-        auto block = node.forge_block_from_mempool(10);
 
+        // A hand-built block that overspends is still refused as a whole.
+        std::string payload = "2\n";
+        for (const auto& tx : {payment1.tx, payment2.tx}) {
+            const auto raw = tx.serialize();
+            payload += std::to_string(raw.size()) + '\n' + raw + '\n';
+        }
+        const auto overspending = node.chain().create_block(payload);
         try {
-            node.commit_local_block(block);
+            node.commit_local_block(overspending);
         } catch (const std::runtime_error&) {
             caught = true;
         }
-
         assert(caught);
         assert(node.wallet("alice").balance() == 100);
         assert(node.wallet("bob").balance() == 0);
         assert(node.mempool_size() == 2);
         assert(node.chain().chain().size() == 1);
+
+        // Forging stops alice's queue at what her balance covers, so the block commits first time.
+        const auto block = node.forge_block_from_mempool(10);
+        node.commit_local_block(block);
+        assert(node.wallet("alice").balance() == 100 - 61);
+        assert(node.wallet("bob").balance() == 60);
+        assert(node.mempool_size() == 1);
+        assert(node.chain().chain().size() == 2);
     }
 
     {
@@ -205,7 +1324,7 @@ int main() {
         node.register_wallet("bob", "bob-secret", 0);
 
         auto signed_tx = node.wallet("alice").create_signed_payment("bob", 10, 1);
-        signed_tx.signature = "tampered";
+        signed_tx.signature = elit21::Hash256(elit21::sha256("tampered"));
 
         try {
             node.submit(signed_tx);
@@ -267,6 +1386,128 @@ int main() {
         assert(readiness.chain_height >= 2);
     }
 
+    {
+        elit21::Node node("RAW");
+        node.register_wallet("alice", "alice-secret", 1'000);
+        node.register_wallet("bob", "bob-secret", 0);
+        node.submit(node.wallet("alice").create_signed_payment("bob", 100, 1));
+        const auto forged = node.forge_block_from_mempool(10);
+
+        // With the orphan pool on (the default), a block whose parent is unknown must not move the wallets.
+        auto early = forged;
+        early.header.index += 1;
+        early.header.previous_hash = forged.hash;
+        early.hash = elit21::compute_hash(early.header, early.payload);
+        bool caught = false;
+        try {
+            node.commit_local_block(early);
+        } catch (const std::runtime_error& e) {
+            caught = std::string(e.what()) == "block does not extend the local tip";
+        }
+        assert(caught && node.chain().orphan_policy().max_blocks != 0);
+        assert(node.chain().height() == 1 && node.chain().orphan_statistics().blocks == 0);
+        assert(node.wallet("alice").balance() == 1'000 && node.wallet("bob").balance() == 0);
+        assert(node.mempool_size() == 1);
+
+        node.commit_local_block(forged);
+        assert(node.chain().height() == 2 && node.wallet("bob").balance() == 100);
+    }
+
+    {
+        elit21::Node source("RAW");
+        source.register_wallet("alice", "alice-secret", 1'000);
+        source.register_wallet("bob", "bob-secret", 50);
+        for (std::uint64_t n = 0; n < 6; ++n) {
+            source.submit(source.wallet("alice").create_signed_payment("bob", 10 + n, 1));
+            source.submit(source.wallet("bob").create_signed_payment("alice", 5, 1));
+            source.commit_local_block(source.forge_block_from_mempool(10));
+        }
+        const auto history = source.chain().blocks(1, source.chain().height());
+
+        elit21::Node replica("RAW");
+        replica.register_wallet("alice", "alice-secret", 1'000);
+        replica.register_wallet("bob", "bob-secret", 50);
+        replica.begin_initial_download({4, history[3].hash});
+        replica.replay_blocks({history.begin(), history.begin() + 2});
+        auto progress = replica.initial_download_progress();
+        assert(progress.blocks == 2 && progress.transactions == 4 && !progress.checkpoint_reached);
+        assert(replica.chain().validated_height() == 1);
+        replica.replay_blocks({history.begin() + 2, history.end()});
+        progress = replica.finish_initial_download();
+        assert(progress.blocks == 6 && progress.transactions == 12 && progress.checkpoint_reached);
+        assert(replica.chain().validated_height() == 7 && replica.chain().is_valid());
+        assert(replica.chain().headers().hash(6) == source.chain().headers().hash(6));
+        assert(replica.wallet("alice").balance() == source.wallet("alice").balance());
+        assert(replica.wallet("bob").balance() == source.wallet("bob").balance());
+
+        elit21::Node wrong("RAW");
+        wrong.register_wallet("alice", "alice-secret", 1'000);
+        wrong.register_wallet("bob", "bob-secret", 50);
+        wrong.begin_initial_download({2, history[0].hash});
+        std::string error;
+        try {
+            wrong.replay_blocks(history);
+        } catch (const std::runtime_error& e) {
+            error = e.what();
+        }
+        assert(error == "assume-valid checkpoint mismatch" && wrong.chain().height() == 2);
+        assert(wrong.wallet("bob").balance() == 50 + 10 - 5 - 1);
+
+        // A block below the checkpoint whose header no longer matches its hash: linkage still holds, so only
+        // the deferred pass catches it, after the earlier call already moved the wallets.
+        auto corrupt = history;
+        corrupt[1].header.timestamp += 1;
+        elit21::Node tampered("RAW");
+        tampered.register_wallet("alice", "alice-secret", 1'000);
+        tampered.register_wallet("bob", "bob-secret", 50);
+        tampered.begin_initial_download({4, history[3].hash});
+        tampered.replay_blocks({corrupt.begin(), corrupt.begin() + 2});
+        assert(tampered.wallet("bob").balance() != 50);
+        error.clear();
+        try {
+            tampered.replay_blocks({corrupt.begin() + 2, corrupt.end()});
+        } catch (const std::runtime_error& e) {
+            error = e.what();
+        }
+        assert(error == "assume-valid history invalid at block 2: hash mismatch");
+        assert(!tampered.chain().in_initial_download() && tampered.chain().height() == 1);
+        assert(tampered.chain().validated_height() == 1);
+        assert(tampered.wallet("alice").balance() == 1'000 && tampered.wallet("bob").balance() == 50);
+
+        // The same through finish_initial_download, before the checkpoint is reached.
+        tampered.begin_initial_download({6, history[5].hash});
+        tampered.replay_blocks({corrupt.begin(), corrupt.begin() + 3});
+        error.clear();
+        try {
+            (void)tampered.finish_initial_download();
+        } catch (const std::runtime_error& e) {
+            error = e.what();
+        }
+        assert(error == "assume-valid history invalid at block 2: hash mismatch");
+        assert(tampered.chain().height() == 1 && tampered.wallet("bob").balance() == 50);
+
+        // A replayed block must extend the tip: parked in the orphan pool, its wallet effects would be
+        // committed while the chain never links it.
+        tampered.begin_initial_download({4, history[3].hash});
+        error.clear();
+        try {
+            tampered.replay_blocks({history[0], history[2]});
+        } catch (const std::runtime_error& e) {
+            error = e.what();
+        }
+        assert(error == "block does not extend the local tip");
+        assert(tampered.chain().height() == 2 && tampered.chain().orphan_statistics().blocks == 0);
+        (void)tampered.finish_initial_download();
+        assert(tampered.chain().height() == 2 && tampered.wallet("bob").balance() == 50 + 10 - 5 - 1);
+
+        // The rest of the genuine history then replays cleanly over that state.
+        tampered.begin_initial_download({4, history[3].hash});
+        tampered.replay_blocks({history.begin() + 1, history.end()});
+        assert(tampered.chain().height() == 7 && tampered.chain().is_valid());
+        assert(tampered.wallet("alice").balance() == source.wallet("alice").balance());
+        assert(tampered.wallet("bob").balance() == source.wallet("bob").balance());
+    }
+
     {
         elit21::Node node;
         node.register_wallet("solo", "solo-secret", 100);